@@ -3,122 +3,669 @@
 #include "Match3.h"
 #include "Math/UnrealMathUtility.h"
 #include "Match3GameMode.h"
+#include "Match3PlayerController.h"
+#include "Match3SessionContext.h"
+#include "Match3GameInstance.h"
 #include "Grid.h"
+#include "PaperGroupedSpriteComponent.h"
+#include "Async/Async.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tile Pool Size"), STAT_Match3TilePoolSize, STATGROUP_Match3);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tile Pool Prewarmed"), STAT_Match3TilePoolPrewarmed, STATGROUP_Match3);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tile Pool Hits"), STAT_Match3TilePoolHits, STATGROUP_Match3);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tile Pool Misses"), STAT_Match3TilePoolMisses, STATGROUP_Match3);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Tile Pool Hit Rate"), STAT_Match3TilePoolHitRate, STATGROUP_Match3);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Falling Tiles Updated"), STAT_Match3FallingTilesUpdated, STATGROUP_Match3);
+DECLARE_CYCLE_STAT(TEXT("Grid Tick"), STAT_Match3GridTick, STATGROUP_Match3);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Tile Sprite Instances Updated"), STAT_Match3TileSpriteInstancesUpdated, STATGROUP_Match3);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Session Lookups Saved Last Cascade"), STAT_Match3SessionLookupsSavedLastCascade, STATGROUP_Match3);
+DECLARE_CYCLE_STAT(TEXT("Grid InitGrid"), STAT_Match3GridInitGrid, STATGROUP_Match3);
+DECLARE_CYCLE_STAT(TEXT("Grid ExecuteMatch"), STAT_Match3GridExecuteMatch, STATGROUP_Match3);
+DECLARE_CYCLE_STAT(TEXT("Grid IsUnwinnable"), STAT_Match3GridIsUnwinnable, STATGROUP_Match3);
+DECLARE_CYCLE_STAT(TEXT("Grid Spawn Cascade Tiles"), STAT_Match3GridSpawnCascadeTiles, STATGROUP_Match3);
+DECLARE_CYCLE_STAT(TEXT("Grid CreateTile"), STAT_Match3GridCreateTile, STATGROUP_Match3);
+DECLARE_CYCLE_STAT(TEXT("Tile Fall Update"), STAT_Match3TileFallUpdate, STATGROUP_Match3);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Tiles Spawned"), STAT_Match3TilesSpawned, STATGROUP_Match3);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Tiles Destroyed"), STAT_Match3TilesDestroyed, STATGROUP_Match3);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Last Cascade Depth"), STAT_Match3LastCascadeDepth, STATGROUP_Match3);
+
+static TAutoConsoleVariable<int32> CVarGroupedTileRendering(
+	TEXT("Match3.GroupedTileRendering"),
+	-1,
+	TEXT("How grids draw their tiles. Takes effect the next time a grid is initialized.\n")
+	TEXT(" -1: use the grid's bUseGroupedTileRendering setting (default)\n")
+	TEXT("  0: each tile draws its own sprite\n")
+	TEXT("  1: one grouped sprite component per tile type"));
 
 // Sets default values
 AGrid::AGrid(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = false;
+	// Tick only runs while tiles are falling, or while a virtualized grid follows the camera.
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
 
 	MinimumRunLength = 3;
 	TileSize.Set(25.0f, 25.0f);
+	TilePoolPrewarmCount = 8;
+	NumPooledTiles = 0;
+	NumPrewarmedTiles = 0;
+	TilePoolHits = 0;
+	TilePoolMisses = 0;
+	LastFallUpdateCount = 0;
+	CascadeStepIndex = INDEX_NONE;
+	bPlayingCascadeSpawns = false;
+	HintTimeBudgetMs = 0.5f;
+	bReshuffleOnDeadlock = false;
+	ReshuffleDuration = 0.5f;
+	bPlayingReshuffle = false;
+	BoardVersion = 0;
+	RandomSeed = 0;
+	bUseGroupedTileRendering = false;
+	bGroupedTileRenderingActive = false;
+	bVirtualizeTiles = false;
+	bVirtualizeTilesActive = false;
+	bRestoredFromSnapshot = false;
+	VisibleRowMargin = 2;
+	ActorMinRow = 0;
+	ActorMaxRow = -1;
+}
+
+void AGrid::BeginPlay()
+{
+	// Restore before the Blueprint BeginPlay runs, so its call to InitGrid finds the grid already set up.
+	UMatch3GameInstance* GameInstance = Cast<UMatch3GameInstance>(GetGameInstance());
+	const FMatch3BoardSnapshot* Snapshot = GameInstance ? GameInstance->GetResumeSnapshot(this) : nullptr;
+	if (Snapshot)
+	{
+		if (RestoreSnapshot(*Snapshot))
+		{
+			bRestoredFromSnapshot = true;
+		}
+		else
+		{
+			// The game mode checks the same conditions, so it won't apply the snapshot's score and timer to the fresh board either.
+			GameInstance->ClearBoardSnapshot();
+		}
+	}
+	Super::BeginPlay();
 }
 
 void AGrid::InitGrid()
+{
+	SCOPE_CYCLE_COUNTER(STAT_Match3GridInitGrid);
+	if (bRestoredFromSnapshot)
+	{
+		bRestoredFromSnapshot = false;
+		return;
+	}
+	ResetGrid();
+	TileRandomStream.Initialize((RandomSeed != 0) ? RandomSeed : FMath::Rand());
+
+	// Lay out the types first, so the board can be checked and fixed before any tiles are spawned.
+	TileSampler.FillBoard(Board, TileRandomStream);
+	if (Board.IsUnwinnable() && !TileSampler.AddLegalMove(Board, TileRandomStream))
+	{
+		UE_LOG(LogMatch3, Warning, TEXT("Grid %s could not be filled with a legal move. Check that at least three tile types can be swapped and have a chance of appearing."), *GetName());
+	}
+	SpawnInitialTiles();
+}
+
+bool AGrid::GetSnapshot(FMatch3BoardSnapshot& OutSnapshot) const
+{
+	if (!IsBoardSettled() || bPlayingReshuffle)
+	{
+		return false;
+	}
+	OutSnapshot.Width = GridWidth;
+	OutSnapshot.Height = GridHeight;
+	OutSnapshot.NumTileTypes = TileLibrary.Num();
+	OutSnapshot.TileTypes.SetNumUninitialized(Board.GetNumSpaces());
+	for (int32 GridAddress = 0; GridAddress < Board.GetNumSpaces(); ++GridAddress)
+	{
+		if (Board.IsEmpty(GridAddress))
+		{
+			return false;
+		}
+		OutSnapshot.TileTypes[GridAddress] = (uint8)Board.GetTileType(GridAddress);
+	}
+	OutSnapshot.RandomSeed = TileRandomStream.GetCurrentSeed();
+	return true;
+}
+
+bool AGrid::CanRestoreSnapshot(const FMatch3BoardSnapshot& Snapshot) const
+{
+	return Snapshot.IsValid() && (Snapshot.Width == GridWidth) && (Snapshot.Height == GridHeight) && (Snapshot.NumTileTypes == TileLibrary.Num());
+}
+
+bool AGrid::RestoreSnapshot(const FMatch3BoardSnapshot& Snapshot)
+{
+	if (!CanRestoreSnapshot(Snapshot))
+	{
+		UE_LOG(LogMatch3, Warning, TEXT("Grid %s can't be restored from a %dx%d snapshot with %d tile types."), *GetName(), Snapshot.Width, Snapshot.Height, Snapshot.NumTileTypes);
+		return false;
+	}
+	ResetGrid();
+	TileRandomStream.Initialize(Snapshot.RandomSeed);
+	for (int32 GridAddress = 0; GridAddress < Board.GetNumSpaces(); ++GridAddress)
+	{
+		Board.SetTile(GridAddress, Snapshot.TileTypes[GridAddress]);
+	}
+	SpawnInitialTiles();
+
+	// The replay has to start from the restored board, since the seed alone would fill a different one.
+	Replay.StartingTileTypes = Snapshot.TileTypes;
+	Replay.StartingScore = Snapshot.Score;
+	Replay.StartingComboPower = Snapshot.ComboPower;
+	return true;
+}
+
+void AGrid::ResetGrid()
 {
 	GameTiles.Empty(GridWidth * GridHeight);
-	GameTiles.AddUninitialized(GameTiles.Max());
-	FVector SpawnLocation;
-	for (int32 Column = 0; Column < GridWidth; ++Column)
+	GameTiles.AddZeroed(GameTiles.Max());
+	Board.Init(GridWidth, GridHeight, MinimumRunLength);
+	++BoardVersion;
+	TilesBeingDestroyed.Init(GridWidth * GridHeight);
+	RefreshTileLibrary();
+	InitTileSpriteGroups();
+}
+
+void AGrid::SpawnInitialTiles()
+{
+	// Spawn tiles for the rows that need them. A virtualized grid starts with the bottom rows, and follows the camera from its first tick.
+	bVirtualizeTilesActive = bVirtualizeTiles;
+	ActorMinRow = 0;
+	ActorMaxRow = -1;
+	SetActorRows(0, bVirtualizeTilesActive ? (VisibleRowMargin * 2) : (GridHeight - 1));
+	if (bVirtualizeTilesActive)
 	{
-		for (int32 Row = 0; Row < GridHeight; ++Row)
+		UpdateVisibleRows();
+		SetActorTickEnabled(true);
+	}
+	MoveIndex.Rebuild(Board);
+	PrewarmTilePool();
+	StartReplay();
+}
+
+void AGrid::StartReplay()
+{
+	Replay.Reset();
+	Replay.Seed = TileRandomStream.GetInitialSeed();
+	GetGameSettings(GameSettings);
+	Replay.Settings = GameSettings;
+}
+
+int32 AGrid::GetCurrentComboPower() const
+{
+	AMatch3GameMode* GameMode = FMatch3SessionContext::GetGameMode(this);
+	return GameMode ? GameMode->GetComboPower() : GameSettings.InitialComboPower;
+}
+
+void AGrid::GetGameSettings(FMatch3GameSettings& OutSettings)
+{
+	OutSettings.Width = GridWidth;
+	OutSettings.Height = GridHeight;
+	OutSettings.MinimumRunLength = MinimumRunLength;
+	OutSettings.bReshuffleOnDeadlock = bReshuffleOnDeadlock;
+	GetBoardTileTypes(OutSettings.TileTypes);
+	for (int32 MoveType = 0; MoveType < EMatch3MoveType::MT_MAX; ++MoveType)
+	{
+		OutSettings.ScoreMultipliers[MoveType] = GetScoreMultiplierForMove((EMatch3MoveType::Type)MoveType);
+	}
+	if (AMatch3GameMode* GameMode = FMatch3SessionContext::GetGameMode(this))
+	{
+		OutSettings.InitialComboPower = GameMode->GetComboPower();
+		OutSettings.MaxComboPower = GameMode->GetMaxComboPower();
+	}
+}
+
+bool AGrid::SaveReplay(const FString& Filename) const
+{
+	FMatch3Replay ReplayToSave = Replay;
+	if (IsBoardSettled())
+	{
+		if (AMatch3PlayerController* PC = FMatch3SessionContext::GetPlayerController(this))
 		{
-			int32 TileID = SelectTileFromLibrary();
-			int32 GridAddress;
-			GetGridAddressWithOffset(0, Column, Row, GridAddress);
-			SpawnLocation = GetLocationFromGridAddress(GridAddress);
+			ReplayToSave.bHasExpectedResult = true;
+			ReplayToSave.ExpectedScore = PC->GetScore();
+			ReplayToSave.ExpectedBoardChecksum = Board.GetChecksum();
+		}
+	}
+	return ReplayToSave.SaveToFile(Filename);
+}
 
-			do
+bool AGrid::RequestHint()
+{
+	if (!IsBoardSettled())
+	{
+		return false;
+	}
+
+	// Copy everything the search reads, so the game can carry on while it runs.
+	FMatch3HintRequest Request;
+	Request.MoveIndex = GetMoveIndex();
+	Request.Board = Board;
+	Request.Settings = GameSettings;
+	Request.Settings.InitialComboPower = GetCurrentComboPower();
+	if (AMatch3GameMode* GameMode = FMatch3SessionContext::GetGameMode(this))
+	{
+		Request.BombPowerBonus = GameMode->CalculateBombPower();
+	}
+	Request.TimeBudget = HintTimeBudgetMs / 1000.0;
+
+	TWeakObjectPtr<AGrid> WeakGrid(this);
+	const int32 HintBoardVersion = BoardVersion;
+	Async<void>(EAsyncExecution::ThreadPool, [WeakGrid, HintBoardVersion, Request]()
+	{
+		FMatch3Hint Hint;
+		Match3Hints::FindBestMove(Request, Hint);
+		AsyncTask(ENamedThreads::GameThread, [WeakGrid, HintBoardVersion, Hint]()
+		{
+			if (AGrid* Grid = WeakGrid.Get())
 			{
-				TileID = SelectTileFromLibrary();
-				if ((Column >= MinimumRunLength - 1) || (Row >= MinimumRunLength - 1))
-				{
-					int32 TestAddress;
-					int32 TileOffset;
-					for (int32 Horizontal = 0; Horizontal < 2; ++Horizontal)
-					{
-						for (TileOffset = 1; TileOffset < MinimumRunLength; ++TileOffset)
-						{
-							if (!GetGridAddressWithOffset(0, Column - (Horizontal ? TileOffset : 0), Row - (Horizontal ? 0 : TileOffset), TestAddress) || (GetTileFromGridAddress(TestAddress)->TileTypeID != TileID))
-							{
-								// Not in a matching run, or off the edge of the map, so stop checking this axis.
-								break;
-							}
-						}
-						if (TileOffset == MinimumRunLength)
-						{
-							// We made it through the whole "check for matching run" loop. This tile completes a scoring run. Pick a new tile type and test again.
-							break;
-						}
-					}
-					if (TileOffset < MinimumRunLength)
-					{
-						// We didn't find a matching run in either direction, so we have a valid tile type.
-						break;
-					}
-				}
-				else
-				{
-					// This tile is too close to the edge to be worth checking.
-					break;
-				}
-			} while (true);
-			CreateTile(TileLibrary[TileID].TileClass, TileLibrary[TileID].TileMaterial, SpawnLocation, GridAddress, TileID);
-		}
+				Grid->OnHintSearchFinished(HintBoardVersion, Hint);
+			}
+		});
+	});
+	return true;
+}
+
+void AGrid::OnHintSearchFinished(int32 HintBoardVersion, const FMatch3Hint& Hint)
+{
+	if (HintBoardVersion == BoardVersion)
+	{
+		LastHint = Hint;
+		OnHintReady(Hint.GridAddressA, Hint.GridAddressB, Hint.Score);
 	}
 }
 
+void AGrid::RefreshTileLibrary()
+{
+	TArray<FMatch3BoardTileType> BoardTileTypes;
+	GetBoardTileTypes(BoardTileTypes);
+	Board.SetTileTypes(BoardTileTypes);
+	TileSampler.Init(BoardTileTypes);
+	GameSettings.TileTypes = MoveTemp(BoardTileTypes);
+
+	// Which tiles explode or can swap may have changed anywhere on the board, so every move is re-evaluated the next time the move index is read,
+	// and hints worked out with the old rules are thrown away.
+	Board.MarkAllDirty();
+	++BoardVersion;
+}
+
+void AGrid::GetBoardTileTypes(TArray<FMatch3BoardTileType>& OutTileTypes) const
+{
+	OutTileTypes.SetNum(TileLibrary.Num());
+	for (int32 TileTypeID = 0; TileTypeID < TileLibrary.Num(); ++TileTypeID)
+	{
+		const FTileType& TileType = TileLibrary[TileTypeID];
+		FMatch3BoardTileType& BoardTileType = OutTileTypes[TileTypeID];
+		BoardTileType.Probability = TileType.Probability;
+		BoardTileType.BombPower = TileType.Abilities.BombPower;
+		BoardTileType.bExplodes = TileType.Abilities.CanExplode();
+		BoardTileType.bPreventSwapping = !TileType.Abilities.CanSwap();
+	}
+}
+
+#if WITH_EDITOR
+void AGrid::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	// Edits inside a tile type report that type's property, so check the outer member instead.
+	const FName MemberPropertyName = PropertyChangedEvent.MemberProperty ? PropertyChangedEvent.MemberProperty->GetFName() : NAME_None;
+	if (MemberPropertyName == GET_MEMBER_NAME_CHECKED(AGrid, TileLibrary))
+	{
+		RefreshTileLibrary();
+	}
+}
+#endif
+
 
 ATile* AGrid::CreateTile(TSubclassOf<class ATile> TileToSpawn, class UMaterialInstanceConstant* TileMaterial, FVector SpawnLocation, int32 SpawnGridAddress, int32 TileTypeID)
 {
+	SCOPE_CYCLE_COUNTER(STAT_Match3GridCreateTile);
 	// If we have set something to spawn:
 	if (TileToSpawn)
 	{
 		checkSlow(TileLibrary.IsValidIndex(TileTypeID));
-		// Check for a valid World:
-		UWorld* const World = GetWorld();
-		if (World)
-		{
-			// Set the spawn parameters.
-			FActorSpawnParameters SpawnParams;
-			SpawnParams.Owner = this;
-			SpawnParams.Instigator = Instigator;
-			SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-			// Tiles never rotate
-			FRotator SpawnRotation(0.0f, 0.0f, 0.0f);
-			// Spawn the tile.
-			ATile* const NewTile = World->SpawnActor<ATile>(TileToSpawn, SpawnLocation, SpawnRotation, SpawnParams);
-			NewTile->GetRenderComponent()->SetMobility(EComponentMobility::Movable);
+		// Reuse a pooled tile if we have one, or spawn a new one.
+		if (ATile* const NewTile = AcquireTile(TileToSpawn, SpawnLocation))
+		{
 			NewTile->TileTypeID = TileTypeID;
 			NewTile->Abilities = TileLibrary[TileTypeID].Abilities;
 			NewTile->SetTileMaterial(TileMaterial);
 			NewTile->SetGridAddress(SpawnGridAddress);
+			NewTile->GetRenderComponent()->SetVisibility(!bGroupedTileRenderingActive);
+			if (bGroupedTileRenderingActive)
+			{
+				AddTileSpriteInstance(NewTile);
+			}
 			GameTiles[SpawnGridAddress] = NewTile;
+			INC_DWORD_STAT(STAT_Match3TilesSpawned);
 			return NewTile;
 		}
 	}
 	return nullptr;
 }
 
-int32 AGrid::SelectTileFromLibrary()
+ATile* AGrid::CreateTileOfType(int32 TileTypeID, const FVector& SpawnLocation, int32 SpawnGridAddress)
+{
+	const FTileType& TileType = TileLibrary[TileTypeID];
+	return CreateTile(TileType.TileClass, TileType.TileMaterial, SpawnLocation, SpawnGridAddress, TileTypeID);
+}
+
+void AGrid::SetActorRows(int32 NewMinRow, int32 NewMaxRow)
 {
-	float NormalizingFactor = 0;
-	for (const FTileType& TileBase : TileLibrary)
+	NewMinRow = FMath::Max(NewMinRow, 0);
+	NewMaxRow = FMath::Min(NewMaxRow, GridHeight - 1);
+	if ((NewMinRow == ActorMinRow) && (NewMaxRow == ActorMaxRow))
 	{
-		NormalizingFactor += TileBase.Probability;
+		return;
+	}
+
+	// Tiles in rows that are leaving the range go back to the pool, then rows entering the range get tiles for whatever the board holds there.
+	for (int32 Row = ActorMinRow; Row <= ActorMaxRow; ++Row)
+	{
+		if ((Row >= NewMinRow) && (Row <= NewMaxRow))
+		{
+			continue;
+		}
+		for (int32 Column = 0; Column < GridWidth; ++Column)
+		{
+			const int32 GridAddress = Column + (Row * GridWidth);
+			if (ATile* Tile = GameTiles[GridAddress])
+			{
+				GameTiles[GridAddress] = nullptr;
+				ReleaseTile(Tile);
+			}
+		}
+	}
+	for (int32 Row = NewMinRow; Row <= NewMaxRow; ++Row)
+	{
+		if ((Row >= ActorMinRow) && (Row <= ActorMaxRow))
+		{
+			continue;
+		}
+		for (int32 Column = 0; Column < GridWidth; ++Column)
+		{
+			const int32 GridAddress = Column + (Row * GridWidth);
+			if (!GameTiles[GridAddress] && !Board.IsEmpty(GridAddress))
+			{
+				CreateTileOfType(Board.GetTileType(GridAddress), GetLocationFromGridAddress(GridAddress), GridAddress);
+			}
+		}
 	}
-	float TestNumber = FMath::FRandRange(0.0f, NormalizingFactor);
-	float CompareTo = 0;
-	for (int32 ArrayChecked = 0; ArrayChecked != TileLibrary.Num(); ArrayChecked++)
+	ActorMinRow = NewMinRow;
+	ActorMaxRow = NewMaxRow;
+}
+
+void AGrid::UpdateVisibleRows()
+{
+	APlayerController* PC = FMatch3SessionContext::GetLocalPlayerController(this);
+	int32 ViewportSizeX, ViewportSizeY;
+	if (!PC || (GridWidth <= 0))
 	{
-		CompareTo += TileLibrary[ArrayChecked].Probability;
-		if (TestNumber <= CompareTo)
+		return;
+	}
+	PC->GetViewportSize(ViewportSizeX, ViewportSizeY);
+	if ((ViewportSizeX <= 0) || (ViewportSizeY <= 0))
+	{
+		return;
+	}
+
+	// Find where the top and bottom of the screen meet the plane the tiles sit on. This works for both orthographic and perspective cameras.
+	const float BottomOfGridZ = GetLocationFromGridAddress(0).Z - (TileSize.Y * 0.5f);
+	int32 ViewRows[2];
+	for (int32 Edge = 0; Edge < 2; ++Edge)
+	{
+		FVector WorldLocation, WorldDirection;
+		if (!PC->DeprojectScreenPositionToWorld(ViewportSizeX * 0.5f, Edge ? 0.0f : (float)ViewportSizeY, WorldLocation, WorldDirection)
+			|| !GetGridPlaneIntersection(WorldLocation, WorldDirection, WorldLocation))
 		{
-			return ArrayChecked;
+			return;
 		}
+		ViewRows[Edge] = FMath::FloorToInt((WorldLocation.Z - BottomOfGridZ) / TileSize.Y);
 	}
-	return 0;
+	SetActorRows(FMath::Min(ViewRows[0], ViewRows[1]) - VisibleRowMargin, FMath::Max(ViewRows[0], ViewRows[1]) + VisibleRowMargin);
+}
+
+ATile* AGrid::AcquireTile(TSubclassOf<class ATile> TileClass, const FVector& SpawnLocation)
+{
+	FTilePoolBucket* Bucket = TilePool.Find(TileClass);
+	if (Bucket && (Bucket->Tiles.Num() > 0))
+	{
+		ATile* const PooledTile = Bucket->Tiles.Pop(false);
+		--NumPooledTiles;
+		++TilePoolHits;
+		UpdateTilePoolStats();
+		PooledTile->SetActorLocation(SpawnLocation);
+		PooledTile->OnTakenFromPool();
+		return PooledTile;
+	}
+
+	// Check for a valid World:
+	UWorld* const World = GetWorld();
+	if (World)
+	{
+		// Set the spawn parameters.
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.Owner = this;
+		SpawnParams.Instigator = Instigator;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		// Tiles never rotate
+		FRotator SpawnRotation(0.0f, 0.0f, 0.0f);
+		// Spawn the tile.
+		ATile* const NewTile = World->SpawnActor<ATile>(TileClass, SpawnLocation, SpawnRotation, SpawnParams);
+		NewTile->GetRenderComponent()->SetMobility(EComponentMobility::Movable);
+		++TilePoolMisses;
+		UpdateTilePoolStats();
+		return NewTile;
+	}
+	return nullptr;
+}
+
+void AGrid::ReleaseTile(ATile* Tile)
+{
+	check(Tile);
+	RemoveFallingTile(Tile);
+	RemoveTileSpriteInstance(Tile);
+	// Pooled tiles can be reused for any space, so they mustn't keep any effect that was playing.
+	if (Tile == CurrentlySelectedTile)
+	{
+		CurrentlySelectedTile = nullptr;
+	}
+	Tile->PlaySelectionEffect(false);
+	Tile->StopFallingEffect();
+	Tile->OnReturnedToPool();
+	TilePool.FindOrAdd(Tile->GetClass()).Tiles.Add(Tile);
+	++NumPooledTiles;
+	UpdateTilePoolStats();
+}
+
+void AGrid::PrewarmTilePool()
+{
+	UWorld* const World = GetWorld();
+	if (!World || (TilePoolPrewarmCount <= 0))
+	{
+		return;
+	}
+
+	// Tiles are spawned out of sight, since they start hidden anyway.
+	const FVector PoolLocation = GetLocationFromGridAddressWithOffset(0, 0, -GridHeight);
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.Owner = this;
+	SpawnParams.Instigator = Instigator;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	for (const FTileType& TileType : TileLibrary)
+	{
+		if (!TileType.TileClass)
+		{
+			continue;
+		}
+		FTilePoolBucket& Bucket = TilePool.FindOrAdd(TileType.TileClass);
+		while (Bucket.Tiles.Num() < TilePoolPrewarmCount)
+		{
+			ATile* const NewTile = World->SpawnActor<ATile>(TileType.TileClass, PoolLocation, FRotator::ZeroRotator, SpawnParams);
+			NewTile->GetRenderComponent()->SetMobility(EComponentMobility::Movable);
+			NewTile->OnReturnedToPool();
+			Bucket.Tiles.Add(NewTile);
+			++NumPooledTiles;
+			++NumPrewarmedTiles;
+		}
+	}
+	UpdateTilePoolStats();
+}
+
+void AGrid::UpdateTilePoolStats() const
+{
+	SET_DWORD_STAT(STAT_Match3TilePoolSize, NumPooledTiles);
+	SET_DWORD_STAT(STAT_Match3TilePoolPrewarmed, NumPrewarmedTiles);
+	SET_DWORD_STAT(STAT_Match3TilePoolHits, TilePoolHits);
+	SET_DWORD_STAT(STAT_Match3TilePoolMisses, TilePoolMisses);
+	const int32 TileRequests = TilePoolHits + TilePoolMisses;
+	SET_FLOAT_STAT(STAT_Match3TilePoolHitRate, (TileRequests > 0) ? ((float)TilePoolHits / (float)TileRequests) : 0.0f);
+}
+
+void AGrid::InitTileSpriteGroups()
+{
+	for (const FTileSpriteGroup& Group : TileSpriteGroups)
+	{
+		if (Group.Component)
+		{
+			Group.Component->DestroyComponent();
+		}
+	}
+	TileSpriteGroups.Reset();
+
+	const int32 ConsoleSetting = CVarGroupedTileRendering.GetValueOnGameThread();
+	bGroupedTileRenderingActive = (ConsoleSetting < 0) ? bUseGroupedTileRendering : (ConsoleSetting > 0);
+	if (!bGroupedTileRenderingActive)
+	{
+		return;
+	}
+
+	// Every tile type needs a sprite to draw. Tile classes set theirs on the default object's render component.
+	TileSpriteGroups.SetNum(TileLibrary.Num());
+	for (int32 TileTypeID = 0; TileTypeID < TileLibrary.Num(); ++TileTypeID)
+	{
+		const FTileType& TileType = TileLibrary[TileTypeID];
+		const ATile* TileCDO = TileType.TileClass ? TileType.TileClass->GetDefaultObject<ATile>() : nullptr;
+		UPaperSprite* Sprite = TileCDO ? TileCDO->GetRenderComponent()->GetSprite() : nullptr;
+		if (!Sprite)
+		{
+			UE_LOG(LogMatch3, Warning, TEXT("%s: tile type %d has no sprite, so tiles will draw themselves."), *GetName(), TileTypeID);
+			TileSpriteGroups.Reset();
+			bGroupedTileRenderingActive = false;
+			return;
+		}
+		TileSpriteGroups[TileTypeID].Sprite = Sprite;
+		TileSpriteGroups[TileTypeID].Material = TileType.TileMaterial;
+	}
+
+	for (FTileSpriteGroup& Group : TileSpriteGroups)
+	{
+		// The player controller picks tiles with grid math, so the batched sprites don't need collision either.
+		Group.Component = NewObject<UPaperGroupedSpriteComponent>(this);
+		Group.Component->SetMobility(EComponentMobility::Movable);
+		Group.Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		if (RootComponent)
+		{
+			Group.Component->SetupAttachment(RootComponent);
+		}
+		else
+		{
+			SetRootComponent(Group.Component);
+		}
+		Group.Component->RegisterComponent();
+	}
+}
+
+void AGrid::AddTileSpriteInstance(ATile* Tile)
+{
+	check(Tile && (Tile->SpriteInstanceIndex == INDEX_NONE));
+	FTileSpriteGroup& Group = TileSpriteGroups[Tile->TileTypeID];
+	const FTransform& TileTransform = Tile->GetActorTransform();
+	Tile->SpriteInstanceIndex = Group.Component->AddInstanceWithMaterial(TileTransform, Group.Sprite, Group.Material, true);
+	check(Tile->SpriteInstanceIndex == Group.Tiles.Num());
+	Group.Tiles.Add(Tile);
+	Group.InstanceTransforms.Add(TileTransform);
+}
+
+void AGrid::RemoveTileSpriteInstance(ATile* Tile)
+{
+	const int32 InstanceIndex = Tile->SpriteInstanceIndex;
+	if (InstanceIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	// Removing from the middle would renumber every later instance, so move the last instance into the freed slot instead.
+	FTileSpriteGroup& Group = TileSpriteGroups[Tile->TileTypeID];
+	const int32 LastIndex = Group.Tiles.Num() - 1;
+	if (InstanceIndex != LastIndex)
+	{
+		ATile* const MovedTile = Group.Tiles[LastIndex];
+		Group.Component->UpdateInstanceTransform(InstanceIndex, Group.InstanceTransforms[LastIndex], true, false);
+		Group.Tiles[InstanceIndex] = MovedTile;
+		Group.InstanceTransforms[InstanceIndex] = Group.InstanceTransforms[LastIndex];
+		MovedTile->SpriteInstanceIndex = InstanceIndex;
+	}
+	Group.Component->RemoveInstance(LastIndex);
+	Group.Tiles.Pop(false);
+	Group.InstanceTransforms.Pop(false);
+	Tile->SpriteInstanceIndex = INDEX_NONE;
+}
+
+void AGrid::UpdateTileSpriteInstance(ATile* Tile, bool bMarkRenderStateDirty)
+{
+	const int32 InstanceIndex = Tile->SpriteInstanceIndex;
+	if (InstanceIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	FTileSpriteGroup& Group = TileSpriteGroups[Tile->TileTypeID];
+	const FTransform& TileTransform = Tile->GetActorTransform();
+	Group.InstanceTransforms[InstanceIndex] = TileTransform;
+	Group.Component->UpdateInstanceTransform(InstanceIndex, TileTransform, true, bMarkRenderStateDirty);
+	Group.bRenderStateDirty |= !bMarkRenderStateDirty;
+	INC_DWORD_STAT(STAT_Match3TileSpriteInstancesUpdated);
+}
+
+void AGrid::FlushTileSpriteInstances()
+{
+	// One render state update per group, however many instances moved.
+	for (FTileSpriteGroup& Group : TileSpriteGroups)
+	{
+		if (Group.bRenderStateDirty)
+		{
+			Group.Component->MarkRenderStateDirty();
+			Group.bRenderStateDirty = false;
+		}
+	}
+}
+
+void AGrid::NotifyTileMoved(ATile* Tile)
+{
+	if (Tile && bGroupedTileRenderingActive)
+	{
+		UpdateTileSpriteInstance(Tile, true);
+	}
+}
+
+int32 AGrid::SelectTileFromLibrary()
+{
+	return GetTileSampler().Sample(TileRandomStream);
+}
+
+const FMatch3TileSampler& AGrid::GetTileSampler()
+{
+	// Tile library edits made without calling RefreshTileLibrary will at least change the number of types.
+	if (TileSampler.Num() != TileLibrary.Num())
+	{
+		RefreshTileLibrary();
+	}
+	return TileSampler;
 }
 
 ATile* AGrid::GetTileFromGridAddress(int32 GridAddress) const
@@ -130,6 +677,18 @@ ATile* AGrid::GetTileFromGridAddress(int32 GridAddress) const
 	return nullptr;
 }
 
+void AGrid::GetTilesFromGridAddresses(const TArray<int32>& GridAddresses, TArray<ATile*>& OutTiles) const
+{
+	OutTiles.Reset(GridAddresses.Num());
+	for (int32 GridAddress : GridAddresses)
+	{
+		if (ATile* Tile = GetTileFromGridAddress(GridAddress))
+		{
+			OutTiles.Add(Tile);
+		}
+	}
+}
+
 FVector AGrid::GetLocationFromGridAddress(int32 GridAddress) const
 {
 	FVector Center = GetActorLocation();
@@ -142,6 +701,36 @@ FVector AGrid::GetLocationFromGridAddress(int32 GridAddress) const
 	return OutLocation;
 }
 
+bool AGrid::GetGridPlaneIntersection(const FVector& RayOrigin, const FVector& RayDirection, FVector& OutLocation) const
+{
+	// Tiles sit on the XZ plane through the grid's location.
+	if (FMath::IsNearlyZero(RayDirection.Y))
+	{
+		return false;
+	}
+	OutLocation = RayOrigin + (RayDirection * ((GetActorLocation().Y - RayOrigin.Y) / RayDirection.Y));
+	return true;
+}
+
+bool AGrid::GetGridAddressFromLocation(const FVector& Location, int32& OutGridAddress) const
+{
+	// This is GetLocationFromGridAddress run backward, measuring from the bottom-left corner of the board.
+	OutGridAddress = INDEX_NONE;
+	if ((GridWidth <= 0) || (TileSize.X <= 0.0f) || (TileSize.Y <= 0.0f))
+	{
+		return false;
+	}
+	const FVector FromCorner = Location - GetActorLocation();
+	const int32 Column = FMath::FloorToInt((FromCorner.X / TileSize.X) + (GridWidth * 0.5f));
+	const int32 Row = FMath::FloorToInt((FromCorner.Z / TileSize.Y) + (GridHeight * 0.5f));
+	if ((Column < 0) || (Column >= GridWidth) || (Row < 0) || (Row >= GridHeight))
+	{
+		return false;
+	}
+	OutGridAddress = Column + (Row * GridWidth);
+	return true;
+}
+
 FVector AGrid::GetLocationFromGridAddressWithOffset(int32 GridAddress, int32 XOffsetInTiles, int32 YOffsetInTiles) const
 {
 	FVector OutLocation = GetLocationFromGridAddress(GridAddress);
@@ -182,136 +771,342 @@ bool AGrid::AreAddressesNeighbors(int32 GridAddressA, int32 GridAddressB) const
 {
 	if ((FMath::Min(GridAddressA, GridAddressB) >= 0) && (FMath::Max(GridAddressA, GridAddressB) < (GridWidth * GridHeight)))
 	{
+		// Addresses one apart are only neighbors if they are in the same row, not at the end of one row and the start of the next.
 		int32 GridAddressOffset = FMath::Abs(GridAddressA - GridAddressB);
-		return ((GridAddressOffset == 1) || (GridAddressOffset == GridWidth));
+		return (((GridAddressOffset == 1) && ((GridAddressA / GridWidth) == (GridAddressB / GridWidth))) || (GridAddressOffset == GridWidth));
 	}
 	return false;
 }
 
-void AGrid::OnTileFinishedFalling(ATile* Tile, int32 LandingGridAddress)
+void AGrid::Tick(float DeltaSeconds)
 {
-	int32 ReturnGridAddress;
+	Super::Tick(DeltaSeconds);
+	SCOPE_CYCLE_COUNTER(STAT_Match3GridTick);
+
+	LastFallUpdateCount = FallAnimTiles.Num();
+	INC_DWORD_STAT_BY(STAT_Match3FallingTilesUpdated, LastFallUpdateCount);
 
-	// Remove the tile from its original position if it's still there (hasn't been replaced by another falling tile).
-	if (GetGridAddressWithOffset(Tile->GetGridAddress(), 0, 0, ReturnGridAddress))
+	// Move every falling tile, then retire the ones that have landed. Retiring can start new falls, so it happens after the arrays are compacted.
+	FinishedFallAnimTiles.Reset();
 	{
-		if (GameTiles[ReturnGridAddress] == Tile)
+		SCOPE_CYCLE_COUNTER(STAT_Match3TileFallUpdate);
+		for (int32 Index = FallAnimTiles.Num() - 1; Index >= 0; --Index)
 		{
-			GameTiles[ReturnGridAddress] = nullptr;
+			ATile* Tile = FallAnimTiles[Index];
+			FallElapsedTimes[Index] += DeltaSeconds;
+			const float FallCompleteFraction = FallElapsedTimes[Index] / FallDurations[Index];
+			if (FallCompleteFraction >= 1.0f)
+			{
+				Tile->SetActorLocation(FallEndLocations[Index]);
+				if (bGroupedTileRenderingActive)
+				{
+					UpdateTileSpriteInstance(Tile, false);
+				}
+				FinishedFallAnimTiles.Add(Tile);
+				FallAnimTiles.RemoveAtSwap(Index, 1, false);
+				FallStartLocations.RemoveAtSwap(Index, 1, false);
+				FallEndLocations.RemoveAtSwap(Index, 1, false);
+				FallElapsedTimes.RemoveAtSwap(Index, 1, false);
+				FallDurations.RemoveAtSwap(Index, 1, false);
+			}
+			else
+			{
+				// Tiles have no physics state to carry along, so skip the sweep and velocity update.
+				Tile->SetActorLocation(FMath::Lerp(FallStartLocations[Index], FallEndLocations[Index], FallCompleteFraction), false, nullptr, ETeleportType::TeleportPhysics);
+				if (bGroupedTileRenderingActive)
+				{
+					UpdateTileSpriteInstance(Tile, false);
+				}
+			}
 		}
 	}
+	FlushTileSpriteInstances();
 
-	// Validate new grid address and replace whatever is there.
-	if (GetGridAddressWithOffset(LandingGridAddress, 0, 0, ReturnGridAddress))
+	for (ATile* Tile : FinishedFallAnimTiles)
 	{
-		GameTiles[ReturnGridAddress] = Tile;
-		Tile->SetGridAddress(ReturnGridAddress);
-		Tile->TileState = ETileState::ETS_Normal;
+		Tile->FinishFalling();
 	}
+	FinishedFallAnimTiles.Reset();
 
-	// This tile is no longer falling, remove it from the list.
-	FallingTiles.RemoveSingleSwap(Tile);
-	TilesToCheck.Add(Tile);
-	if (FallingTiles.Num() == 0)
+	// Everything else that moves a tile updates its sprite instance itself, so there is nothing to do between falls.
+	if ((FallAnimTiles.Num() == 0) && !bVirtualizeTilesActive)
 	{
-		// Done with all falling tiles. Spawn new ones at the top of each column in the appropriate quantity.
-		RespawnTiles();
+		SetActorTickEnabled(false);
+	}
+
+	// Tile actors only follow the view between moves, while GameTiles matches the board.
+	if (bVirtualizeTilesActive && IsBoardSettled())
+	{
+		UpdateVisibleRows();
 	}
 }
 
-void AGrid::OnTileFinishedMatching(ATile* InTile)
+void AGrid::AddFallingTile(ATile* Tile, const FVector& StartLocation, const FVector& EndLocation, float Duration /* = 0.0f */)
 {
-	if (InTile)
+	check(Tile);
+	float FallDuration = Duration;
+	AMatch3GameMode* CurrentGameMode = FMatch3SessionContext::GetGameMode(this);
+	if ((FallDuration <= 0.0f) && CurrentGameMode && (CurrentGameMode->TileMoveSpeed > 0.0f))
 	{
-		TilesBeingDestroyed.RemoveSwap(InTile);
-		InTile->Destroy();
+		FallDuration = (StartLocation.Z - EndLocation.Z) / CurrentGameMode->TileMoveSpeed;
 	}
-	if (TilesBeingDestroyed.Num() == 0)
+	if (FallDuration <= 0.0f)
+	{
+		FallDuration = 0.75f;
+	}
+
+	FallAnimTiles.Add(Tile);
+	FallStartLocations.Add(StartLocation);
+	FallEndLocations.Add(EndLocation);
+	FallElapsedTimes.Add(0.0f);
+	FallDurations.Add(FallDuration);
+	SetActorTickEnabled(true);
+}
+
+void AGrid::RemoveFallingTile(ATile* Tile)
+{
+	const int32 Index = FallAnimTiles.Find(Tile);
+	if (Index != INDEX_NONE)
 	{
-		// Make all tiles fall if they are above empty space.
-		for (ATile* Tile : FallingTiles)
+		FallAnimTiles.RemoveAtSwap(Index);
+		FallStartLocations.RemoveAtSwap(Index);
+		FallEndLocations.RemoveAtSwap(Index);
+		FallElapsedTimes.RemoveAtSwap(Index);
+		FallDurations.RemoveAtSwap(Index);
+	}
+}
+
+void AGrid::OnTileFinishedFalling(ATile* Tile)
+{
+	// This tile is no longer falling, remove it from the list.
+	FallingTiles.RemoveSingleSwap(Tile);
+	if (!IsRowActorBacked(Tile->GetGridAddress() / GridWidth))
+	{
+		// The tile has moved out of the rows that keep actors.
+		GameTiles[Tile->GetGridAddress()] = nullptr;
+		ReleaseTile(Tile);
+	}
+	if (FallingTiles.Num() == 0)
+	{
+		if (bPlayingReshuffle)
+		{
+			bPlayingReshuffle = false;
+			PlayNextCascadeStep();
+		}
+		else if (!bPlayingCascadeSpawns)
 		{
-			Tile->StartFalling();
+			// Done with all falling tiles. Drop the new ones in from the top of each column.
+			PlayCascadeSpawns();
 		}
+		else
+		{
+			PlayNextCascadeStep();
+		}
+	}
+}
 
-		if (FallingTiles.Num() == 0)
+void AGrid::OnTileFinishedMatching(ATile* InTile)
+{
+	if (InTile && TilesBeingDestroyed.Remove(InTile->GetGridAddress()))
+	{
+		INC_DWORD_STAT(STAT_Match3TilesDestroyed);
+		ReleaseTile(InTile);
+		if (TilesBeingDestroyed.IsEmpty())
 		{
-			RespawnTiles();
+			MatchedTiles.Reset();
+			PlayCascadeFalls();
 		}
 	}
 }
 
-void AGrid::RespawnTiles()
+void AGrid::PlayNextCascadeStep()
 {
-	for (int32 x = 0; x < GridWidth; ++x)
+	++CascadeStepIndex;
+	if (!CascadeScript.Steps.IsValidIndex(CascadeStepIndex))
 	{
-		// Replace all null tiles, starting from the top of the column. Stop when we hit a non-null tile.
-		int32 BaseAddress, TestAddress;
-		if (GetGridAddressWithOffset(0, x, GridHeight - 1, BaseAddress))
+		SET_DWORD_STAT(STAT_Match3SessionLookupsSavedLastCascade, FMatch3SessionContext::GetNumLookupsSaved(this));
+
+		// Everything the cascade did to the score, medals and timer reaches the HUD in one update, before the game can end.
+		if (AMatch3GameMode* GameMode = FMatch3SessionContext::GetGameMode(this))
 		{
-			int32 y_depth;
-			for (y_depth = 0; GetGridAddressWithOffset(BaseAddress, 0, -y_depth, TestAddress) && (!GetTileFromGridAddress(TestAddress)); ++y_depth)
+			GameMode->EndHUDUpdate();
+		}
+
+		// The board now looks the way it has been since the move was resolved.
+		if (IsUnwinnable())
+		{
+			if (bReshuffleOnDeadlock && ReshuffleTiles())
 			{
-				// This loop finds the lowest Y value, but does nothing with it.
+				// Input stays blocked until the tiles have moved. This runs again once they land, and finds a legal move.
+				return;
 			}
-			for (int32 y = y_depth - 1; y >= 0; --y)
+			CascadeStepIndex = INDEX_NONE;
+			if (AMatch3GameMode* GameMode = FMatch3SessionContext::GetGameMode(this))
 			{
-				int32 NewTileTypeID = SelectTileFromLibrary();
-				GetGridAddressWithOffset(BaseAddress, 0, -y, TestAddress);
-				// Move our tile up visually so it has room to fall, but don't change its grid address. The new grid address would be off-grid and invalid anyway.
-				if (ATile* NewTile = CreateTile(TileLibrary[NewTileTypeID].TileClass, TileLibrary[NewTileTypeID].TileMaterial, GetLocationFromGridAddressWithOffset(TestAddress, 0, (y_depth + 1)), TestAddress, NewTileTypeID))
-				{
-					TilesToCheck.Add(NewTile);
-					NewTile->TileState = ETileState::ETS_Falling;
-					check(!FallingTiles.Contains(NewTile));
-					FallingTiles.Add(NewTile);
-				}
+				GameMode->GameOver();
+				return;
 			}
 		}
-		else
+		CascadeStepIndex = INDEX_NONE;
+		UMatch3BlueprintFunctionLibrary::PauseGameTimer(this, false);
+
+		// The board is settled, so the game can be picked up from here if the application is stopped.
+		if (UMatch3GameInstance* GameInstance = Cast<UMatch3GameInstance>(GetGameInstance()))
 		{
-			check(false);
+			GameInstance->SaveBoardSnapshot(this);
 		}
+		return;
 	}
 
-	if (FallingTiles.Num() > 0)
+	// Score each match as it is shown, so the displayed score counts up in step with the tiles. HUD events are held until the cascade is over.
+	const FMatch3CascadeStep& Step = CascadeScript.Steps[CascadeStepIndex];
+	SetLastMove(Step.MoveType);
+	if (AMatch3GameMode* GameMode = FMatch3SessionContext::GetGameMode(this))
 	{
-		// Any falling tiles that exist at this point are new ones, and are falling from physical locations (off-grid) to their correct locations.
-		for (ATile* Tile : FallingTiles)
+		if (CascadeStepIndex == 0)
 		{
-			Tile->StartFalling(true);
+			GameMode->BeginHUDUpdate();
 		}
+		GameMode->SetComboPower(Step.ComboPower);
+		OnMoveMade(Step.MoveType);
+		GameMode->AddScore(Step.Score);
+	}
+
+	TArray<ATile*> MatchingTiles;
+	GetTilesFromGridAddresses(Step.MatchedGridAddresses, MatchingTiles);
+	if (MatchingTiles.Num() == 0)
+	{
+		// No tiles to destroy, so there is nothing to wait for.
+		PlayCascadeFalls();
 		return;
 	}
+	MatchedTiles = MatchingTiles;
+	for (ATile* Tile : MatchingTiles)
+	{
+		TilesBeingDestroyed.Add(Tile->GetGridAddress());
+		GameTiles[Tile->GetGridAddress()] = nullptr;
+	}
+	// Tiles can finish matching as soon as they are told to, so the falls start from OnTileFinishedMatching once the last one is done.
+	for (ATile* Tile : MatchingTiles)
+	{
+		Tile->OnMatched(Step.MoveType);
+	}
+}
 
-	// Check to see if any matches have been made automatically.
-	TArray<ATile*> AllMatchingTiles;
-	for (ATile* Tile : TilesToCheck)
+void AGrid::PlayCascadeFalls()
+{
+	const FMatch3CascadeStep& Step = CascadeScript.Steps[CascadeStepIndex];
+	bPlayingCascadeSpawns = false;
+
+	// Pick up every falling tile before putting any down, since a tile can land where another one started.
+	// On a virtualized grid, a tile falling into view from a row without actors gets one, and a tile that never comes into view is left as board data.
+	check(FallingTiles.Num() == 0);
+	TArray<ATile*> MovingTiles;
+	MovingTiles.Reserve(Step.Falls.Num());
+	for (const FMatch3CascadeFall& Fall : Step.Falls)
 	{
-		TArray<ATile*> MatchingTiles = FindNeighbors(Tile);
-		for (ATile* MatchingTile : MatchingTiles)
+		ATile* FallingTile = GameTiles[Fall.FromGridAddress];
+		if (!FallingTile && IsRowActorBacked(Fall.ToGridAddress / GridWidth))
 		{
-			AllMatchingTiles.AddUnique(MatchingTile);
+			FallingTile = CreateTileOfType(Fall.TileTypeID, GetLocationFromGridAddress(Fall.FromGridAddress), Fall.FromGridAddress);
+		}
+		MovingTiles.Add(FallingTile);
+	}
+	for (const FMatch3CascadeFall& Fall : Step.Falls)
+	{
+		GameTiles[Fall.FromGridAddress] = nullptr;
+	}
+	for (int32 FallIndex = 0; FallIndex < Step.Falls.Num(); ++FallIndex)
+	{
+		if (ATile* FallingTile = MovingTiles[FallIndex])
+		{
+			const int32 LandingGridAddress = Step.Falls[FallIndex].ToGridAddress;
+			GameTiles[LandingGridAddress] = FallingTile;
+			FallingTile->SetGridAddress(LandingGridAddress);
+			FallingTiles.Add(FallingTile);
 		}
 	}
 
-	if (AllMatchingTiles.Num() > 0)
+	if (FallingTiles.Num() == 0)
 	{
-		SetLastMove(EMatch3MoveType::MT_Combo);
-		ExecuteMatch(AllMatchingTiles);
+		PlayCascadeSpawns();
+		return;
 	}
-	else
+	for (ATile* Tile : FallingTiles)
 	{
-		if (IsUnwinnable())
+		Tile->StartFalling();
+	}
+}
+
+void AGrid::PlayCascadeSpawns()
+{
+	SCOPE_CYCLE_COUNTER(STAT_Match3GridSpawnCascadeTiles);
+	const FMatch3CascadeStep& Step = CascadeScript.Steps[CascadeStepIndex];
+	bPlayingCascadeSpawns = true;
+
+	// Move each new tile up visually so it has room to fall. Its grid address is already the space it will land in.
+	check(FallingTiles.Num() == 0);
+	for (const FMatch3CascadeSpawn& Spawn : Step.Spawns)
+	{
+		if (!IsRowActorBacked(Spawn.GridAddress / GridWidth))
 		{
-			if (AMatch3GameMode* GameMode = Cast<AMatch3GameMode>(UGameplayStatics::GetGameMode(this)))
-			{
-				GameMode->GameOver();
-				return;
-			}
+			continue;
 		}
-		UMatch3BlueprintFunctionLibrary::PauseGameTimer(this, false);
+		if (ATile* NewTile = CreateTileOfType(Spawn.TileTypeID, GetLocationFromGridAddressWithOffset(Spawn.GridAddress, 0, Spawn.FallDistance), Spawn.GridAddress))
+		{
+			FallingTiles.Add(NewTile);
+		}
+	}
+
+	if (FallingTiles.Num() == 0)
+	{
+		PlayNextCascadeStep();
+		return;
+	}
+	for (ATile* Tile : FallingTiles)
+	{
+		Tile->StartFalling();
+	}
+}
+
+bool AGrid::ReshuffleTiles()
+{
+	TArray<int32> SourceGridAddresses;
+	if (!Board.Reshuffle(TileRandomStream, SourceGridAddresses))
+	{
+		return false;
+	}
+	++BoardVersion;
+
+	// The same actors are moved to their new spaces, all at once. On a virtualized grid, tiles moving into view from rows without actors get one.
+	const TArray<ATile*> OldGameTiles = GameTiles;
+	check(FallingTiles.Num() == 0);
+	for (int32 GridAddress = 0; GridAddress < GameTiles.Num(); ++GridAddress)
+	{
+		const int32 SourceGridAddress = SourceGridAddresses[GridAddress];
+		ATile* Tile = OldGameTiles[SourceGridAddress];
+		if (!Tile && IsRowActorBacked(GridAddress / GridWidth))
+		{
+			Tile = CreateTileOfType(Board.GetTileType(GridAddress), GetLocationFromGridAddress(SourceGridAddress), GridAddress);
+		}
+		GameTiles[GridAddress] = Tile;
+		if (Tile && (SourceGridAddress != GridAddress))
+		{
+			Tile->SetGridAddress(GridAddress);
+			FallingTiles.Add(Tile);
+		}
+	}
+	if (FallingTiles.Num() == 0)
+	{
+		return false;
+	}
+	bPlayingReshuffle = true;
+	OnBoardReshuffled();
+	for (ATile* Tile : FallingTiles)
+	{
+		AddFallingTile(Tile, Tile->GetActorLocation(), GetLocationFromGridAddress(Tile->GetGridAddress()), ReshuffleDuration);
 	}
+	return true;
 }
 
 void AGrid::SwapTiles(ATile* A, ATile* B, bool bRepositionTileActors /* = false */)
@@ -324,12 +1119,16 @@ void AGrid::SwapTiles(ATile* A, ATile* B, bool bRepositionTileActors /* = false
 	// Swap array positions for A and B
 	GameTiles[A->GetGridAddress()] = A;
 	GameTiles[B->GetGridAddress()] = B;
+	Board.SwapTiles(A->GetGridAddress(), B->GetGridAddress());
+	++BoardVersion;
 
 	if (bRepositionTileActors)
 	{
 		// Move tiles to their new positions
 		A->SetActorLocation(GetLocationFromGridAddress(A->GetGridAddress()));
 		B->SetActorLocation(GetLocationFromGridAddress(B->GetGridAddress()));
+		NotifyTileMoved(A);
+		NotifyTileMoved(B);
 	}
 }
 
@@ -337,182 +1136,71 @@ TArray<ATile*> AGrid::GetExplosionList(ATile* A) const
 {
 	check(A);
 	check(A->Abilities.CanExplode());
-	int32 AdjustedBombPower = A->Abilities.BombPower;
-	if (AMatch3GameMode* GameMode = Cast<AMatch3GameMode>(UGameplayStatics::GetGameMode(A)))
+	TArray<int32> ExplosionAddresses;
+	Board.GetExplosionList(A->GetGridAddress(), GetAdjustedBombPower(A->GetGridAddress()), ExplosionAddresses);
+	TArray<ATile*> ExplosionTiles;
+	GetTilesFromGridAddresses(ExplosionAddresses, ExplosionTiles);
+	return ExplosionTiles;
+}
+
+int32 AGrid::GetAdjustedBombPower(int32 GridAddress) const
+{
+	check(Board.CanExplode(GridAddress));
+	int32 AdjustedBombPower = Board.GetTileTypes()[Board.GetTileType(GridAddress)].BombPower;
+	if (AMatch3GameMode* GameMode = FMatch3SessionContext::GetGameMode(this))
 	{
 		AdjustedBombPower = FMath::Max(1, AdjustedBombPower + 1 + GameMode->CalculateBombPower());
 	}
-	return FindNeighbors(A, false, AdjustedBombPower);
+	return AdjustedBombPower;
 }
 
 bool AGrid::IsMoveLegal(ATile* A, ATile* B)
 {
-	if (A && B && (A != B) && A->Abilities.CanSwap() && B->Abilities.CanSwap())
+	if (A && B)
 	{
-		if ((A->TileTypeID != B->TileTypeID) && AreAddressesNeighbors(A->GetGridAddress(), B->GetGridAddress()))
-		{
-			// Swap tiles A and B.
-			SwapTiles(A, B);
-
-			// Check for matches with A and B in their proposed positions.
-			LastLegalMatch = FindNeighbors(A);
-			LastLegalMatch.Append(FindNeighbors(B));
-
-			// Restore positions for A and B.
-			SwapTiles(A, B);
-
-			return (LastLegalMatch.Num() > 0);
-		}
+		return Board.IsMoveLegal(A->GetGridAddress(), B->GetGridAddress(), &LastLegalMatch);
 	}
 	return false;
 }
 
 TArray<ATile*> AGrid::FindNeighbors(ATile* StartingTile, bool bMustMatchID /* = true */, int32 RunLength /* = MinimumRunLength */) const
 {
-	int32 NeighborGridAddress;
-	ATile* NeighborTile;
-	TArray<ATile*> MatchInProgress;
+	TArray<int32> MatchingAddresses;
+	Board.FindNeighbors(StartingTile->GetGridAddress(), MatchingAddresses, bMustMatchID, RunLength);
 	TArray<ATile*> AllMatchingTiles;
-
-	if (RunLength < 0)
-	{
-		RunLength = MinimumRunLength;
-	}
-
-	// Handle special, trivial cases.
-	if (RunLength == 0)
-	{
-		return AllMatchingTiles;
-	}
-	else if (RunLength == 1)
-	{
-		AllMatchingTiles.Add(StartingTile);
-		return AllMatchingTiles;
-	}
-
-	// Check verticals, then check horizontals.
-	for (int32 Horizontal = 0; Horizontal < 2; ++Horizontal)
-	{
-		// Check negative direction, then check positive direction.
-		for (int32 Direction = -1; Direction <= 1; Direction += 2)
-		{
-			int32 MaxGridOffset = !bMustMatchID ? RunLength : (Horizontal ? GridWidth : GridHeight);
-			// Check run length. A run ends when we go off the edge of the map or hit a tile that doesn't match, provided we care about matching.
-			for (int32 GridOffset = 1; GridOffset < MaxGridOffset; ++GridOffset)
-			{
-				if (GetGridAddressWithOffset(StartingTile->GetGridAddress(), Direction * (Horizontal ? GridOffset : 0), Direction * (Horizontal ? 0 : GridOffset), NeighborGridAddress))
-				{
-					NeighborTile = GetTileFromGridAddress(NeighborGridAddress);
-					if (NeighborTile && (!bMustMatchID || (NeighborTile->TileTypeID == StartingTile->TileTypeID)))
-					{
-						MatchInProgress.Add(NeighborTile);
-						continue;
-					}
-					break;
-				}
-			}
-		}
-		// See if we have enough to complete a run, or if matching wasn't required. If so, keep the tiles. Note that we add 1 to our match-in-progress because the starting tile isn't counted yet.
-		if (!bMustMatchID || ((MatchInProgress.Num() + 1) >= FMath::Min(RunLength, Horizontal ? GridWidth : GridHeight)))
-		{
-			AllMatchingTiles.Append(MatchInProgress);
-		}
-		MatchInProgress.Empty();
-	}
-	// If we found any other tile, or if we're not concerned with matching TileID, then we know we have a valid run, and we need to add the original tile to the list.
-	// If we do care about matching tile type and we haven't found anything by this point, then we don't have a match and should not return the starting tile in a list by itself.
-	if ((AllMatchingTiles.Num() > 0) || !bMustMatchID)
-	{
-		AllMatchingTiles.Add(StartingTile);
-	}
+	GetTilesFromGridAddresses(MatchingAddresses, AllMatchingTiles);
 	return AllMatchingTiles;
 }
 
 TArray<ATile*> AGrid::FindTilesOfType(int32 TileTypeID) const
 {
+	TArray<int32> MatchingAddresses;
+	Board.FindTilesOfType(TileTypeID, MatchingAddresses);
 	TArray<ATile*> ReturnList;
-	for (ATile* Tile : GameTiles)
-	{
-		if (Tile && (Tile->TileTypeID == TileTypeID))
-		{
-			ReturnList.Add(Tile);
-		}
-	}
+	GetTilesFromGridAddresses(MatchingAddresses, ReturnList);
 	return ReturnList;
 }
 
-// We're using a constant array reference for MatchingTiles.
+// We're using a constant array reference for MatchingGridAddresses.
 // Constant because we know we'll never change the contents of the array inside this function.
 // Reference because we don't need to make a local copy of the array, and it is often better for performance to avoid copying.
-void AGrid::ExecuteMatch(const TArray<ATile*>& MatchingTiles)
+void AGrid::ExecuteMatch(const TArray<int32>& MatchingGridAddresses)
 {
-	if (MatchingTiles.Num() == 0)
+	SCOPE_CYCLE_COUNTER(STAT_Match3GridExecuteMatch);
+	if (MatchingGridAddresses.Num() == 0)
 	{
 		return;
 	}
+	FMatch3SessionContext::ResetNumLookupsSaved(this);
 	UMatch3BlueprintFunctionLibrary::PauseGameTimer(this, true);
-	// Destroy all tiles in MatchingTiles and award points.
-	for (ATile* Tile : MatchingTiles)
-	{
-		// Tell all tiles above any tile we're about to destroy that they need to fall. Up on the screen is negative Y on the grid.
-		int32 NextAddressUp;
-		ATile* NextTileUp;
-		for (int32 YOffset = 1; YOffset < GridHeight; ++YOffset)
-		{
-			if (GetGridAddressWithOffset(Tile->GetGridAddress(), 0, YOffset, NextAddressUp))
-			{
-				NextTileUp = GetTileFromGridAddress(NextAddressUp);
-				// If the tile above us is invalid or is being destroyed, stop adding to the list.
-				if (NextTileUp && !MatchingTiles.Contains(NextTileUp))
-				{
-					// Set the tile to falling state as soon as it is added to the list.
-					NextTileUp->TileState = ETileState::ETS_Falling;
-					check(!FallingTiles.Contains(NextTileUp));
-					FallingTiles.Add(NextTileUp);
-					continue;
-				}
-				break;
-			}
-		}
-		Tile->TileState = ETileState::ETS_PendingDelete;
-	}
-
-	/** Establish number of tiles we'll need to check after moving tiles and refilling the board. */
-	TilesToCheck.Reset(FallingTiles.Num() + MatchingTiles.Num());
-
-	// Add score based on tile count.
-	{
-		if (AMatch3GameMode* GameMode = Cast<AMatch3GameMode>(UGameplayStatics::GetGameMode(this)))
-		{
-			EMatch3MoveType::Type MT = GetLastMove();
-			int32 ScoreMult = GetScoreMultiplierForMove(MT);
-			// Special results for certain move types.
-			switch (MT)
-			{
-			case EMatch3MoveType::MT_Bomb:
-			case EMatch3MoveType::MT_AllTheBombs:
-				// Clear combo when bombing.
-				GameMode->SetComboPower(0);
-				break;
-			case EMatch3MoveType::MT_Combo:
-				// Power up combo!
-				GameMode->SetComboPower(FMath::Min(GameMode->GetMaxComboPower(), GameMode->GetComboPower() + 1));
-				break;
-			}
-			OnMoveMade(MT);
-			GameMode->AddScore(MatchingTiles.Num() * ScoreMult);
-		}
 
-		for (ATile* Tile : MatchingTiles)
-		{
-			TilesBeingDestroyed.Add(Tile);
-			GameTiles[Tile->GetGridAddress()] = nullptr;
-			Tile->OnMatched(GetLastMove());
-		}
-	}
+	++BoardVersion;
 
-	// Check in case there are no tiles to destroy.
-	OnTileFinishedMatching(nullptr);
+	// Work out the whole cascade now. Board holds the final result from here on, and the tile actors catch up as the script is played.
+	CascadeResolver.Resolve(Board, GetTileSampler(), TileRandomStream, GameSettings, MatchingGridAddresses, GetLastMove(), GetCurrentComboPower(), CascadeScript);
+	SET_DWORD_STAT(STAT_Match3LastCascadeDepth, CascadeScript.NumMatches);
+	CascadeStepIndex = INDEX_NONE;
+	PlayNextCascadeStep();
 }
 
 void AGrid::OnSwapDisplayFinished(ATile* Tile)
@@ -524,6 +1212,7 @@ void AGrid::OnSwapDisplayFinished(ATile* Tile)
 		bPendingSwapMove = false;
 		if (bPendingSwapMoveSuccess)
 		{
+			// LastLegalMatch was found with the tiles in their swapped positions, so make the swap before executing it.
 			SwapTiles(SwappingTiles[0], SwappingTiles[1], true);
 			SwappingTiles.Reset();
 			if (LastLegalMatch.Num() > MinimumRunLength)
@@ -548,12 +1237,23 @@ void AGrid::OnSwapDisplayFinished(ATile* Tile)
 void AGrid::OnTileWasSelected(ATile* NewSelectedTile)
 {
 	// Can't select tiles while tiles are animating/moving, or game is not active.
-	if (FallingTiles.Num() || TilesBeingDestroyed.Num() || bPendingSwapMove || !UMatch3BlueprintFunctionLibrary::IsGameActive(this) || !NewSelectedTile)
+	if ((CascadeStepIndex != INDEX_NONE) || FallingTiles.Num() || !TilesBeingDestroyed.IsEmpty() || bPendingSwapMove || !UMatch3BlueprintFunctionLibrary::IsGameActive(this) || !NewSelectedTile)
 	{
 		return;
 	}
 
 	FTileType& NewSelectedTileType = TileLibrary[NewSelectedTile->TileTypeID];
+
+	// Record the selection so the game can be replayed. Bomb power can be changed by Blueprints, so the bonus in effect now is saved with bomb selections.
+	int32 BombPowerBonus = 0;
+	if (!CurrentlySelectedTile && NewSelectedTileType.Abilities.CanExplode())
+	{
+		if (AMatch3GameMode* GameMode = FMatch3SessionContext::GetGameMode(this))
+		{
+			BombPowerBonus = GameMode->CalculateBombPower();
+		}
+	}
+	Replay.Inputs.Add(FMatch3ReplayInput(NewSelectedTile->GetGridAddress(), BombPowerBonus));
 	if (CurrentlySelectedTile)
 	{
 		// Selecting a neighbor results in attempting a move.
@@ -582,33 +1282,34 @@ void AGrid::OnTileWasSelected(ATile* NewSelectedTile)
 		// Check for various special abilities on the (single) selected tile.
 		if (NewSelectedTileType.Abilities.CanExplode())
 		{
-			TArray<ATile*> TilesToDestroy;
+			TArray<int32> TilesToDestroy;
 
-			if (AMatch3GameMode* GameMode = Cast<AMatch3GameMode>(UGameplayStatics::GetGameMode(this)))
+			if (AMatch3GameMode* GameMode = FMatch3SessionContext::GetGameMode(this))
 			{
 				if (GameMode->GetComboPower() == GameMode->GetMaxComboPower())
 				{
 					// Detonate all bombs at once!
 					SetLastMove(EMatch3MoveType::MT_AllTheBombs);
 					// If we had multiple bomb types, this would only find the type of bomb we clicked on, because we're matching by checking TileTypeID instead of bCanExplode.
-					TArray<ATile*> Bombs = FindTilesOfType(NewSelectedTile->TileTypeID);
-					TArray<ATile*> TilesToDestroyForCurrentBomb;
-					for (ATile* Bomb : Bombs)
+					TArray<int32> Bombs;
+					Board.FindTilesOfType(NewSelectedTile->TileTypeID, Bombs);
+					// Explosions overlap, so they are merged in a set. Tiles covered by more than one bomb are only destroyed once.
+					FMatch3AddressSet TilesToDestroySet;
+					TilesToDestroySet.Init(Board.GetNumSpaces());
+					TArray<int32> TilesToDestroyForCurrentBomb;
+					for (int32 Bomb : Bombs)
 					{
-						TilesToDestroyForCurrentBomb = GetExplosionList(Bomb);
-						for (ATile* TileToCheck : TilesToDestroyForCurrentBomb)
-						{
-							// Don't add tiles that are already covered by a different bomb.
-							TilesToDestroy.AddUnique(TileToCheck);
-						}
+						Board.GetExplosionList(Bomb, GetAdjustedBombPower(Bomb), TilesToDestroyForCurrentBomb);
+						TilesToDestroySet.Append(TilesToDestroyForCurrentBomb);
 					}
+					TilesToDestroySet.GetGridAddresses(TilesToDestroy);
 				}
 			}
 			if (TilesToDestroy.Num() == 0)
 			{
 				// Regular bomb detonation, need to establish a list of tiles to destroy.
 				SetLastMove(EMatch3MoveType::MT_Bomb);
-				TilesToDestroy = GetExplosionList(NewSelectedTile);
+				Board.GetExplosionList(NewSelectedTile->GetGridAddress(), GetAdjustedBombPower(NewSelectedTile->GetGridAddress()), TilesToDestroy);
 			}
 			ExecuteMatch(TilesToDestroy);
 		}
@@ -628,41 +1329,20 @@ void AGrid::OnTileWasSelected(ATile* NewSelectedTile)
 
 bool AGrid::IsUnwinnable()
 {
-	for (ATile* Tile : GameTiles)
-	{
-		check(Tile);
-		int32 TileGridAddress = Tile->GetGridAddress();
-		int32 NeighborGridAddress;
-		// Bombs are always valid.
-		if (Tile->Abilities.CanExplode())
-		{
-			return false;
-		}
-		// If any tile can move in any direction, then the game is not unwinnable.
-		if (GetGridAddressWithOffset(TileGridAddress, 0, -1, NeighborGridAddress) && IsMoveLegal(Tile, GetTileFromGridAddress(NeighborGridAddress)))
-		{
-			return false;
-		}
-		if (GetGridAddressWithOffset(TileGridAddress, 0, 1, NeighborGridAddress) && IsMoveLegal(Tile, GetTileFromGridAddress(NeighborGridAddress)))
-		{
-			return false;
-		}
-		if (GetGridAddressWithOffset(TileGridAddress, -1, 0, NeighborGridAddress) && IsMoveLegal(Tile, GetTileFromGridAddress(NeighborGridAddress)))
-		{
-			return false;
-		}
-		if (GetGridAddressWithOffset(TileGridAddress, 1, 0, NeighborGridAddress) && IsMoveLegal(Tile, GetTileFromGridAddress(NeighborGridAddress)))
-		{
-			return false;
-		}
-	}
-	// No powerups or other non-tile moves are available, and no tiles can move in any direction.
-	return true;
+	SCOPE_CYCLE_COUNTER(STAT_Match3GridIsUnwinnable);
+	return !GetMoveIndex().HasLegalMove();
+}
+
+const FMatch3MoveIndex& AGrid::GetMoveIndex()
+{
+	// Only the moves around spaces that changed since the last update are re-evaluated.
+	MoveIndex.Update(Board);
+	return MoveIndex;
 }
 
 void AGrid::SetLastMove(EMatch3MoveType::Type MoveType)
 {
-	if (APlayerController* PC = UMatch3BlueprintFunctionLibrary::GetLocalPlayerController(this))
+	if (APlayerController* PC = FMatch3SessionContext::GetLocalPlayerController(this))
 	{
 		// Find (or add) the entry for this PlayerController and set it to the type of move that was just made.
 		// This is primarily useful for multiplayer games, but will work in single-player as well.
@@ -675,7 +1355,7 @@ EMatch3MoveType::Type AGrid::GetLastMove()
 {
 	// Retrieve the type of move most recently made by the given player.
 	// This could be stored as a single variable instead of a TMap if we were certain that our game would never support multiplayer.
-	if (APlayerController* PC = UMatch3BlueprintFunctionLibrary::GetLocalPlayerController(this))
+	if (APlayerController* PC = FMatch3SessionContext::GetLocalPlayerController(this))
 	{
 		if (EMatch3MoveType::Type* MoveType = LastMoves.Find(PC))
 		{
@@ -694,9 +1374,9 @@ int32 AGrid::GetScoreMultiplierForMove_Implementation(EMatch3MoveType::Type Last
 void AGrid::ReturnMatchSounds(TArray<USoundWave*>& MatchSounds)
 {
 	MatchSounds.Reset();
-	if (TilesBeingDestroyed.Num() > 0)
+	if (!TilesBeingDestroyed.IsEmpty())
 	{
-		for (ATile* Tile : TilesBeingDestroyed)
+		for (ATile* Tile : MatchedTiles)
 		{
 			MatchSounds.AddUnique(Tile->GetMatchSound());
 		}
@@ -5,6 +5,13 @@
 #include "GameFramework/Actor.h"
 #include "PaperSprite.h"
 #include "Tile.h"
+#include "Match3Board.h"
+#include "Match3MoveIndex.h"
+#include "Match3TileSampler.h"
+#include "Match3CascadeResolver.h"
+#include "Match3HintEngine.h"
+#include "Match3Replay.h"
+#include "Match3BoardSnapshot.h"
 #include "Grid.generated.h"
 
 //
@@ -35,6 +42,50 @@ struct FTileType
 	}
 };
 
+/** Tiles of one class that are hidden and waiting to be reused. */
+USTRUCT()
+struct FTilePoolBucket
+{
+	GENERATED_USTRUCT_BODY();
+
+	UPROPERTY()
+	TArray<ATile*> Tiles;
+};
+
+/** Every tile of one type, drawn as instances of a single grouped sprite component. */
+USTRUCT()
+struct FTileSpriteGroup
+{
+	GENERATED_USTRUCT_BODY();
+
+	UPROPERTY()
+	class UPaperGroupedSpriteComponent* Component;
+
+	UPROPERTY()
+	UPaperSprite* Sprite;
+
+	UPROPERTY()
+	class UMaterialInterface* Material;
+
+	/** The tile drawn by each instance, in instance order. */
+	UPROPERTY()
+	TArray<ATile*> Tiles;
+
+	/** World transform last given to each instance. */
+	TArray<FTransform> InstanceTransforms;
+
+	/** True if instances have moved since the component's render state was last updated. */
+	bool bRenderStateDirty;
+
+	FTileSpriteGroup()
+	: Component(nullptr)
+	, Sprite(nullptr)
+	, Material(nullptr)
+	, bRenderStateDirty(false)
+	{
+	}
+};
+
 UCLASS()
 class MATCH3_API AGrid : public AActor
 {
@@ -66,18 +117,128 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Tile)
 	int32 GridHeight;
 
+	/** Number of spare tiles of each class in TileLibrary to spawn when the grid is initialized, so that early refills don't have to spawn actors. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Tile)
+	int32 TilePoolPrewarmCount;
+
+	/** Draw every tile through one grouped sprite component per tile type instead of each tile's own sprite component. Takes effect when the grid is initialized, and can be overridden with Match3.GroupedTileRendering. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Rendering)
+	uint32 bUseGroupedTileRendering : 1;
+
+	/** Only keep tile actors for the rows in the camera's view, plus VisibleRowMargin rows above and below. The rest of the board is kept as data only, and actors are reused as the view scrolls. Takes effect when the grid is initialized. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Tile)
+	uint32 bVirtualizeTiles : 1;
+
+	/** Rows beyond each edge of the view that keep tile actors when bVirtualizeTiles is set, so tiles are ready before they scroll into view. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Tile, meta = (ClampMin = "0"))
+	int32 VisibleRowMargin;
+
+	/** True if the space has a tile actor when its row holds a tile. Always true unless the grid is virtualized. */
+	bool IsRowActorBacked(int32 Row) const { return ((Row >= ActorMinRow) && (Row <= ActorMaxRow)); }
+
+	/** True if tiles are currently drawn through grouped sprite components. */
+	bool IsUsingGroupedTileRendering() const { return bGroupedTileRenderingActive; }
+
+	/** Call this after moving a tile actor outside of the grid, such as from a Blueprint effect, so its grouped sprite follows it. Does nothing if the tile draws itself. */
+	UFUNCTION(BlueprintCallable, Category = Rendering)
+	void NotifyTileMoved(ATile* Tile);
+
+	/** Seed for the grid's random stream, which picks every tile type the grid spawns. If zero, a new seed is picked each time the grid is initialized. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Tile)
+	int32 RandomSeed;
+
+	/** The seed the grid's random stream was started with when the grid was last initialized. Setting RandomSeed to this value reproduces the same tiles. */
+	UFUNCTION(BlueprintCallable, Category = Tile)
+	int32 GetInitialRandomSeed() const { return TileRandomStream.GetInitialSeed(); }
+
+	/** Every tile selection made since the grid was initialized, with the settings and seed needed to play the game again. */
+	const FMatch3Replay& GetReplay() const { return Replay; }
+
+	/** Write the replay of the current game to a file. If the board is settled, the current score and board are saved with it so playback can be checked. */
+	UFUNCTION(BlueprintCallable, Category = Replay)
+	bool SaveReplay(const FString& Filename) const;
+
+	/** True if no tiles are moving or waiting to be matched. */
+	bool IsBoardSettled() const { return (CascadeStepIndex == INDEX_NONE) && (FallingTiles.Num() == 0) && TilesBeingDestroyed.IsEmpty() && !bPendingSwapMove; }
+
+	/** The cascade caused by the most recent move. It is resolved as soon as the move is made, so its score and the board it leaves are known before any tile starts to move. */
+	const FMatch3CascadeScript& GetCascadeScript() const { return CascadeScript; }
+
+	/** When no moves are left, move the tiles into a new layout that has a legal move instead of ending the game. The game still ends if no such layout can be made. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Game)
+	uint32 bReshuffleOnDeadlock : 1;
+
+	/** Time the tiles take to move to their new spaces when the board is reshuffled, in seconds. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Game, meta = (ClampMin = "0.01"))
+	float ReshuffleDuration;
+
+	/** Called when the board has run out of moves and the tiles start moving to a new layout. */
+	UFUNCTION(BlueprintImplementableEvent, Category = Game)
+	void OnBoardReshuffled();
+
+	/** Longest a hint search may take before it settles for the best move found so far, in milliseconds. Zero means no limit. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Hint, meta = (ClampMin = "0"))
+	float HintTimeBudgetMs;
+
+	/**
+	 * Start looking for the best available move on a worker thread. OnHintReady is called on the game thread when the search is done, unless the board changes first.
+	 * Returns false if the board isn't settled, since the tiles don't show the board being searched until then.
+	 */
+	UFUNCTION(BlueprintCallable, Category = Hint)
+	bool RequestHint();
+
+	/** Called when a hint search started by RequestHint finishes. GridAddressB is -1 if the hint is to detonate the bomb at GridAddressA, and both are -1 if there is no move. */
+	UFUNCTION(BlueprintImplementableEvent, Category = Hint)
+	void OnHintReady(int32 GridAddressA, int32 GridAddressB, int32 Score);
+
+	/** The result of the most recent hint search that finished while its board was still current. */
+	const FMatch3Hint& GetLastHint() const { return LastHint; }
+
+	/** Describe this grid's game for FMatch3HeadlessGame. Combo settings come from the game mode, if there is one. */
+	void GetGameSettings(FMatch3GameSettings& OutSettings);
+	/** Get the rule-relevant parts of TileLibrary. */
+	void GetBoardTileTypes(TArray<FMatch3BoardTileType>& OutTileTypes) const;
+
+	/** Rebuild everything that is cached from TileLibrary, including the index of legal moves and bombs. Call this after changing TileLibrary at runtime. */
+	UFUNCTION(BlueprintCallable, Category = Tile)
+	void RefreshTileLibrary();
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
 	/** Spawn a tile and associate it with a specific grid address. */
 	ATile* CreateTile(TSubclassOf<class ATile> TileToSpawn, class UMaterialInstanceConstant* TileMaterial, FVector SpawnLocation, int32 SpawnGridAddress, int32 TileTypeID);
-	/** Randomly select a type of tile from the grid's library, using the probability values on the tiles. */
+	/** Spawn a tile of a type from TileLibrary. */
+	ATile* CreateTileOfType(int32 TileTypeID, const FVector& SpawnLocation, int32 SpawnGridAddress);
+	/** Randomly select a type of tile from the grid's library, using the probability values on the tiles and the grid's random stream. */
 	int32 SelectTileFromLibrary();
 
 	/** Get the pointer to the tile at the specified grid address. */
 	ATile* GetTileFromGridAddress(int32 GridAddress) const;
+	/** Get the tiles at a list of grid addresses. Empty spaces are skipped. */
+	void GetTilesFromGridAddresses(const TArray<int32>& GridAddresses, TArray<ATile*>& OutTiles) const;
+
+	/** The board data that the game rules run on. GameTiles holds the actor for each space on this board, except while a cascade is being shown, when Board is already in its final state, and in rows without actors on a virtualized grid. */
+	const FMatch3Board& GetBoard() const { return Board; }
 
-	/** Initialize the tiles on the grid*/
+	/** Initialize the tiles on the grid. Does nothing if the grid was already restored from a snapshot in BeginPlay. */
 	UFUNCTION(BlueprintCallable, Category = Initialization)
 	void InitGrid();
 
+	/** Resume a game that was interrupted in a previous run, if the game instance has a snapshot for this level. */
+	virtual void BeginPlay() override;
+
+	/** Fill in the board and random stream parts of a snapshot. Returns false if the board isn't settled. */
+	bool GetSnapshot(FMatch3BoardSnapshot& OutSnapshot) const;
+	/** True if a snapshot was taken from a grid of this size and tile library, so RestoreSnapshot will accept it. */
+	bool CanRestoreSnapshot(const FMatch3BoardSnapshot& Snapshot) const;
+	/**
+	 * Set the grid up with the board from a snapshot instead of filling it, and spawn its tiles. No cascade is run, since a settled board has no runs.
+	 * The replay is restarted, so it can't reproduce the restored board. Returns false if the snapshot doesn't fit this grid.
+	 */
+	bool RestoreSnapshot(const FMatch3BoardSnapshot& Snapshot);
+
 	/** Play effects when a move is made. Use this to avoid spamming sounds on tiles. */
 	UFUNCTION(BlueprintImplementableEvent, meta = (ExpandEnumAsExecs = "MoveType"), Category = Tile)
 	void OnMoveMade(EMatch3MoveType::Type MoveType);
@@ -88,6 +249,11 @@ public:
 	/** Get the world location for a given grid address. */
 	UFUNCTION(BlueprintCallable, Category = Tile)
 	FVector GetLocationFromGridAddress(int32 GridAddress) const;
+	/** Find where a ray, such as one from a screen position, meets the plane the tiles sit on. Returns false if the ray runs along the plane. */
+	bool GetGridPlaneIntersection(const FVector& RayOrigin, const FVector& RayDirection, FVector& OutLocation) const;
+	/** Get the grid address of the space containing a location on the grid's plane. Returns false if the location is off the board. */
+	UFUNCTION(BlueprintCallable, Category = Tile)
+	bool GetGridAddressFromLocation(const FVector& Location, int32& OutGridAddress) const;
 	/** Get the world location for a grid address relative to another grid address. Offset between addresses is measured in tiles. */
 	FVector GetLocationFromGridAddressWithOffset(int32 GridAddress, int32 XOffsetInTiles, int32 YOffsetInTiles) const;
 	/** Get a grid address relative to another grid address. Offset between addresses is measured in tiles. */
@@ -96,11 +262,17 @@ public:
 	/** Determine if two grid addresses are valid and adjacent. */
 	bool AreAddressesNeighbors(int32 GridAddressA, int32 GridAddressB) const;
 
-	void OnTileFinishedFalling(ATile* Tile, int32 LandingGridAddress);
+	virtual void Tick(float DeltaSeconds) override;
+
+	/** Move a tile from StartLocation to EndLocation over the next few frames, then call its FinishFalling. If Duration isn't given, it comes from the game mode's TileMoveSpeed. */
+	void AddFallingTile(ATile* Tile, const FVector& StartLocation, const FVector& EndLocation, float Duration = 0.0f);
+	/** Number of tiles moved by the most recent falling update. */
+	int32 GetLastFallUpdateCount() const { return LastFallUpdateCount; }
+
+	void OnTileFinishedFalling(ATile* Tile);
 	void OnTileFinishedMatching(ATile* InTile);
 	void OnSwapDisplayFinished(ATile* InTile);
 
-	void RespawnTiles();
 	void SwapTiles(ATile* A, ATile* B, bool bRepositionTileActors = false);
 
 	/** Tests a move to see if it's permitted. */
@@ -108,18 +280,23 @@ public:
 
 	/** Get list of tiles that will be affected by a bomb's explosion. */
 	TArray<ATile*> GetExplosionList(ATile* A) const;
+	/** Get the power of the bomb at the given address, including any bonus from the game mode. */
+	int32 GetAdjustedBombPower(int32 GridAddress) const;
 	/** Check for a successful sequence. bMustMatchID can be set to false to ignore matching. MinimumLengthRequired will default to the game's MinimumRunLength setting if negative. */
 	TArray<ATile*> FindNeighbors(ATile* StartingTile, bool bMustMatchID = true, int32 RunLength = -1) const;
 	/** Find all tiles of a given type. */
 	TArray<ATile*> FindTilesOfType(int32 TileTypeID) const;
-	/** Execute the result of one or more matches. It is possible, with multiple matches, to have more than one tile type in the array. */
-	void ExecuteMatch(const TArray<ATile*>& MatchingTiles);
+	/** Execute the result of one or more matches, and every cascade they cause. It is possible, with multiple matches, to have more than one tile type in the array. */
+	void ExecuteMatch(const TArray<int32>& MatchingGridAddresses);
 	/** React to a tile being clicked. */
 	void OnTileWasSelected(ATile* NewSelectedTile);
 
 	/** Detects unwinnable states. */
 	bool IsUnwinnable();
 
+	/** Every move currently available to the player, brought up to date with the board. Only valid while the board is settled. */
+	const FMatch3MoveIndex& GetMoveIndex();
+
 	/** Establishes the most recent move type for the specified player. */
 	void SetLastMove(EMatch3MoveType::Type MoveType);
 
@@ -138,16 +315,134 @@ protected:
 	ATile* CurrentlySelectedTile;
 
 private:
-	/** Array of tiles found in the most recent call to IsMoveLegal. */
-	TArray<ATile*> LastLegalMatch;
+	/** Picks tile types in proportion to their probability values. Built from TileLibrary by RefreshTileLibrary. */
+	FMatch3TileSampler TileSampler;
+	/** Source of every random tile type the grid picks. */
+	FRandomStream TileRandomStream;
+	/** TileSampler, rebuilt first if TileLibrary has changed size since it was built. */
+	const FMatch3TileSampler& GetTileSampler();
+
+	/** Take the result of a hint search, if no move has been made since it was requested. */
+	void OnHintSearchFinished(int32 HintBoardVersion, const FMatch3Hint& Hint);
+	/** Changed whenever the board changes, so hints for an old board can be thrown away. */
+	int32 BoardVersion;
+	FMatch3Hint LastHint;
+
+	/** Show the next match in CascadeScript, or finish the move if there are none left. */
+	void PlayNextCascadeStep();
+	/** Drop the tiles above the current step's match into the spaces it left. */
+	void PlayCascadeFalls();
+	/** Drop the current step's new tiles in from above the board. */
+	void PlayCascadeSpawns();
+
+	/** Works out each move's cascade on Board. */
+	FMatch3CascadeResolver CascadeResolver;
+	/** The cascade being shown, or the last one shown. */
+	FMatch3CascadeScript CascadeScript;
+	/** Index of the step of CascadeScript being shown, or INDEX_NONE once the tiles have caught up with Board. */
+	int32 CascadeStepIndex;
+	/** True once the current step's falls have landed and its new tiles are dropping in. */
+	uint32 bPlayingCascadeSpawns : 1;
+
+	/** Rearrange the tiles on a board with no moves left and start moving them to their new spaces. Returns false if the board couldn't be rearranged. */
+	bool ReshuffleTiles();
+	/** True while tiles are moving to their spaces after a reshuffle. */
+	uint32 bPlayingReshuffle : 1;
+
+	/** Clear the board and the tiles, ready to be filled. */
+	void ResetGrid();
+	/** Spawn tiles for the board once it has been filled, and start a new replay. */
+	void SpawnInitialTiles();
+	/** True if BeginPlay restored the grid from a snapshot, so the level's call to InitGrid should be skipped. */
+	uint32 bRestoredFromSnapshot : 1;
+
+	/** Start a new replay with the grid's current settings and seed, and cache those settings for the game. */
+	void StartReplay();
+	/**
+	 * Settings of the current game, gathered once when it starts so moves don't call GetScoreMultiplierForMove again. Also kept up to date by RefreshTileLibrary.
+	 * InitialComboPower is the combo power the game started with. Use GetCurrentComboPower for the combo power now.
+	 */
+	FMatch3GameSettings GameSettings;
+	/** The game mode's combo power, or the starting combo power if there is no game mode. */
+	int32 GetCurrentComboPower() const;
+	/** The game so far, recorded as it is played. */
+	FMatch3Replay Replay;
+
+	/** Take a tile of the given class from the pool and move it to SpawnLocation, or spawn a new one if the pool is empty. */
+	ATile* AcquireTile(TSubclassOf<class ATile> TileClass, const FVector& SpawnLocation);
+	/** Hide a tile that is no longer on the grid and keep it for reuse. */
+	void ReleaseTile(ATile* Tile);
+	/** Fill the pool with TilePoolPrewarmCount tiles of each class in TileLibrary. */
+	void PrewarmTilePool();
+	void UpdateTilePoolStats() const;
+
+	/** Hidden tiles waiting to be reused, by class. */
+	UPROPERTY()
+	TMap<UClass*, FTilePoolBucket> TilePool;
+	/** Total number of tiles in TilePool. */
+	int32 NumPooledTiles;
+	/** Number of tiles spawned to fill the pool ahead of time. */
+	int32 NumPrewarmedTiles;
+	/** Number of tile requests served from the pool and by spawning a new actor. */
+	int32 TilePoolHits;
+	int32 TilePoolMisses;
+
+	/** Decide which rendering mode to use and create a grouped sprite component for each tile type if needed. */
+	void InitTileSpriteGroups();
+	/** Start drawing a tile through the grouped sprite component for its type. */
+	void AddTileSpriteInstance(ATile* Tile);
+	/** Stop drawing a tile through its grouped sprite component. The last instance is moved into the freed slot. */
+	void RemoveTileSpriteInstance(ATile* Tile);
+	/** Copy a tile's transform onto its sprite instance. If bMarkRenderStateDirty is false, the change isn't drawn until FlushTileSpriteInstances is called. */
+	void UpdateTileSpriteInstance(ATile* Tile, bool bMarkRenderStateDirty);
+	/** Send the moved instances of every group to the renderer, once per group. */
+	void FlushTileSpriteInstances();
+
+	/** One entry per tile type while grouped rendering is active, otherwise empty. */
+	UPROPERTY(Transient)
+	TArray<FTileSpriteGroup> TileSpriteGroups;
+	/** Rendering mode chosen when the grid was initialized. */
+	uint32 bGroupedTileRenderingActive : 1;
+
+	/** Give tile actors to the rows from NewMinRow to NewMaxRow, and return the tiles in every other row to the pool. Only call this while GameTiles matches Board. */
+	void SetActorRows(int32 NewMinRow, int32 NewMaxRow);
+	/** Move the rows that have tile actors to follow the local player's view. */
+	void UpdateVisibleRows();
+	/** Virtualization mode chosen when the grid was initialized. */
+	uint32 bVirtualizeTilesActive : 1;
+	/** Rows that have tile actors, inclusive. */
+	int32 ActorMinRow;
+	int32 ActorMaxRow;
+
+	/** Stop moving a tile without finishing its fall. */
+	void RemoveFallingTile(ATile* Tile);
+
+	/** Falling animation state, one entry per tile in FallAnimTiles. Kept in parallel arrays so the per-frame update walks contiguous data. */
+	UPROPERTY(Transient)
+	TArray<ATile*> FallAnimTiles;
+	TArray<FVector> FallStartLocations;
+	TArray<FVector> FallEndLocations;
+	TArray<float> FallElapsedTimes;
+	TArray<float> FallDurations;
+	/** Tiles that reached the end of their fall this frame. */
+	TArray<ATile*> FinishedFallAnimTiles;
+	/** Number of tiles moved by the most recent falling update. */
+	int32 LastFallUpdateCount;
+
+	/** Type, state and ability data for every space on the grid. */
+	FMatch3Board Board;
+	/** Legal moves on Board. Updated from the board's dirty region after each cascade settles. */
+	FMatch3MoveIndex MoveIndex;
+	/** Grid addresses found in the most recent call to IsMoveLegal, as they will be once the swap has been made. */
+	TArray<int32> LastLegalMatch;
 	/** Tiles that are currently falling. */
 	TArray<ATile*> FallingTiles;
 	/** Tiles that are currently swapping positions with each other. Should be exactly two of them, or zero. */
 	TArray<ATile*> SwappingTiles;
-	/** After spawning new tiles, which tiles to check for automatic matches. */
-	TArray<ATile*> TilesToCheck;
-	/** Tiles that are currently reacting to being matches. */
-	TArray<ATile*> TilesBeingDestroyed;
+	/** Grid addresses of the tiles that are currently reacting to being matched. */
+	FMatch3AddressSet TilesBeingDestroyed;
+	/** Tiles matched by the step being shown, until they have all finished reacting. */
+	TArray<ATile*> MatchedTiles;
 	/** The type of move last executed by a given player. */
 	TMap<APlayerController*, EMatch3MoveType::Type> LastMoves;
 	/** Indicates that we are waiting to complete a swap move. When SwappingTiles is populated by two tiles, we are done. */
@@ -2,4 +2,6 @@
 
 #include "Match3.h"
 
+DEFINE_LOG_CATEGORY(LogMatch3);
+
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, Match3, "Match3" );
@@ -4,3 +4,7 @@
 
 #include "Engine.h"
 #include "Match3BlueprintFunctionLibrary.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogMatch3, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("Match3"), STATGROUP_Match3, STATCAT_Advanced);
@@ -0,0 +1,592 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "Match3.h"
+#include "Match3Benchmark.h"
+#include "Match3BotPolicy.h"
+#include "Match3CascadeResolver.h"
+#include "Match3TileSampler.h"
+#include "Match3GameMode.h"
+#include "Match3PlayerController.h"
+#include "Grid.h"
+#include "Match3SaveGame.h"
+#include "Match3SaveWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+
+FMatch3ScopedAllocationCounter::FMatch3ScopedAllocationCounter()
+	: InnerMalloc(GMalloc)
+	, NumAllocations(0)
+	, NumReallocations(0)
+{
+	GMalloc = this;
+}
+
+FMatch3ScopedAllocationCounter::~FMatch3ScopedAllocationCounter()
+{
+	check(GMalloc == this);
+	GMalloc = InnerMalloc;
+}
+
+void* FMatch3ScopedAllocationCounter::Malloc(SIZE_T Count, uint32 Alignment)
+{
+	FPlatformAtomics::InterlockedIncrement(&NumAllocations);
+	return InnerMalloc->Malloc(Count, Alignment);
+}
+
+void* FMatch3ScopedAllocationCounter::Realloc(void* Original, SIZE_T Count, uint32 Alignment)
+{
+	// Realloc of nothing is a new allocation, and realloc to nothing is a free.
+	if (!Original)
+	{
+		FPlatformAtomics::InterlockedIncrement(&NumAllocations);
+	}
+	else if (Count > 0)
+	{
+		FPlatformAtomics::InterlockedIncrement(&NumReallocations);
+	}
+	return InnerMalloc->Realloc(Original, Count, Alignment);
+}
+
+void FMatch3ScopedAllocationCounter::Free(void* Original)
+{
+	InnerMalloc->Free(Original);
+}
+
+void Match3Benchmark::FillRandomBoard(FMatch3Board& Board, int32 Width, int32 Height, int32 NumTileTypes, int32 MinimumRunLength, int32 Seed)
+{
+	TArray<FMatch3BoardTileType> TileTypes;
+	TileTypes.SetNum(NumTileTypes);
+	Board.Init(Width, Height, MinimumRunLength);
+	Board.SetTileTypes(TileTypes);
+
+	FRandomStream RandomStream(Seed);
+	for (int32 GridAddress = 0; GridAddress < Board.GetNumSpaces(); ++GridAddress)
+	{
+		Board.SetTile(GridAddress, RandomStream.RandRange(0, NumTileTypes - 1));
+	}
+}
+
+bool Match3Benchmark::BenchmarkMatchDetection(int32 Width, int32 Height, int32 NumTileTypes, int32 Iterations, TArray<FMatch3BenchmarkResult>& OutResults)
+{
+	FMatch3Board Board;
+	FillRandomBoard(Board, Width, Height, NumTileTypes, 3, 0x4D334D33);
+	Iterations = FMath::Max(1, Iterations);
+
+	// Per-tile path, as used when every tile on the board needs to be checked.
+	TArray<int32> AllGridAddresses;
+	for (int32 GridAddress = 0; GridAddress < Board.GetNumSpaces(); ++GridAddress)
+	{
+		AllGridAddresses.Add(GridAddress);
+	}
+	TArray<int32> NeighborMatches;
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+	{
+		Board.FindMatches(AllGridAddresses, NeighborMatches);
+	}
+	FMatch3BenchmarkResult& NeighborResult = OutResults[OutResults.AddDefaulted()];
+	NeighborResult.Name = FString::Printf(TEXT("FindNeighbors %dx%d"), Width, Height);
+	NeighborResult.Iterations = Iterations;
+	NeighborResult.SecondsPerIteration = (FPlatformTime::Seconds() - StartTime) / Iterations;
+
+	if (!Board.SupportsBitboards())
+	{
+		UE_LOG(LogMatch3, Warning, TEXT("Bitboard match detection supports boards up to %d columns wide; skipping %dx%d."), FMatch3Board::MaxBitboardWidth, Width, Height);
+		return true;
+	}
+
+	FMatch3BoardMask MatchMask;
+	StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+	{
+		Board.FindAllMatches(MatchMask);
+	}
+	FMatch3BenchmarkResult& BitboardResult = OutResults[OutResults.AddDefaulted()];
+	BitboardResult.Name = FString::Printf(TEXT("Bitboard %dx%d"), Width, Height);
+	BitboardResult.Iterations = Iterations;
+	BitboardResult.SecondsPerIteration = (FPlatformTime::Seconds() - StartTime) / Iterations;
+
+	// Both paths must agree on which spaces are matched.
+	TArray<int32> BitboardMatches;
+	MatchMask.GetGridAddresses(Width, BitboardMatches);
+	NeighborMatches.Sort();
+	if (NeighborMatches != BitboardMatches)
+	{
+		UE_LOG(LogMatch3, Error, TEXT("Bitboard match detection found %d matching tiles on a %dx%d board, FindNeighbors found %d."), BitboardMatches.Num(), Width, Height, NeighborMatches.Num());
+		return false;
+	}
+	return true;
+}
+
+/** Time Iterations calls of Function and add the result. */
+template <typename FunctionType>
+static void TimeRule(const FString& Name, int32 Iterations, TArray<FMatch3BenchmarkResult>& OutResults, FunctionType Function)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+	{
+		Function();
+	}
+	FMatch3BenchmarkResult& Result = OutResults[OutResults.AddDefaulted()];
+	Result.Name = Name;
+	Result.Iterations = Iterations;
+	Result.SecondsPerIteration = (FPlatformTime::Seconds() - StartTime) / Iterations;
+}
+
+void Match3Benchmark::BenchmarkRules(int32 Width, int32 Height, int32 NumTileTypes, int32 Iterations, TArray<FMatch3BenchmarkResult>& OutResults)
+{
+	Iterations = FMath::Max(1, Iterations);
+	NumTileTypes = FMath::Max(NumTileTypes, 4);
+	const FString Size = FString::Printf(TEXT("%dx%d"), Width, Height);
+
+	// A random board, with runs left in place so the searches have something to find.
+	FMatch3Board Board;
+	FillRandomBoard(Board, Width, Height, NumTileTypes, 3, 0x4D334D33);
+	TArray<int32> Found;
+	TimeRule(TEXT("FindNeighbors all ") + Size, Iterations, OutResults, [&]()
+	{
+		for (int32 GridAddress = 0; GridAddress < Board.GetNumSpaces(); ++GridAddress)
+		{
+			Board.FindNeighbors(GridAddress, Found);
+		}
+	});
+	int32 NumLegalMoves = 0;
+	TimeRule(TEXT("IsMoveLegal all ") + Size, Iterations, OutResults, [&]()
+	{
+		for (int32 GridAddress = 0; GridAddress < Board.GetNumSpaces(); ++GridAddress)
+		{
+			int32 NeighborGridAddress;
+			if (Board.GetGridAddressWithOffset(GridAddress, 1, 0, NeighborGridAddress) && Board.IsMoveLegal(GridAddress, NeighborGridAddress, &Found))
+			{
+				++NumLegalMoves;
+			}
+			if (Board.GetGridAddressWithOffset(GridAddress, 0, 1, NeighborGridAddress) && Board.IsMoveLegal(GridAddress, NeighborGridAddress, &Found))
+			{
+				++NumLegalMoves;
+			}
+		}
+	});
+
+	// The same board with one type turned into bombs.
+	TArray<FMatch3BoardTileType> BombTileTypes = Board.GetTileTypes();
+	BombTileTypes[0].bExplodes = true;
+	Board.SetTileTypes(BombTileTypes);
+	TArray<int32> BombGridAddresses;
+	Board.FindTilesOfType(0, BombGridAddresses);
+	TimeRule(TEXT("GetExplosionList all ") + Size, Iterations, OutResults, [&]()
+	{
+		for (int32 GridAddress : BombGridAddresses)
+		{
+			Board.GetExplosionList(GridAddress, 3, Found);
+		}
+	});
+
+	// A board with no runs, as play leaves it, with three tiles in the middle of the bottom row treated as matched. Each run starts from the same board and seed.
+	FMatch3GameSettings Settings;
+	Settings.Width = Width;
+	Settings.Height = Height;
+	Settings.TileTypes.SetNum(NumTileTypes);
+	FMatch3TileSampler TileSampler;
+	TileSampler.Init(Settings.TileTypes);
+	FMatch3Board FilledBoard;
+	FilledBoard.Init(Width, Height, Settings.MinimumRunLength);
+	FilledBoard.SetTileTypes(Settings.TileTypes);
+	FRandomStream RandomStream(0x4D33);
+	TileSampler.FillBoard(FilledBoard, RandomStream);
+	const TArray<int32> Matched = { (Width / 2) - 1, Width / 2, (Width / 2) + 1 };
+	FMatch3CascadeResolver Resolver;
+	FMatch3CascadeScript Script;
+	TimeRule(TEXT("ResolveCascade ") + Size, Iterations, OutResults, [&]()
+	{
+		Board = FilledBoard;
+		RandomStream.Initialize(0x4D33);
+		Resolver.Resolve(Board, TileSampler, RandomStream, Settings, Matched, EMatch3MoveType::MT_Standard, 0, Script);
+	});
+
+	// Repeating 2x2 blocks of four types have no moves, so IsUnwinnable can't stop early.
+	Board.Init(Width, Height, 3);
+	Board.SetTileTypes(Settings.TileTypes);
+	for (int32 GridAddress = 0; GridAddress < Board.GetNumSpaces(); ++GridAddress)
+	{
+		Board.SetTile(GridAddress, ((GridAddress % Width) % 2) + (((GridAddress / Width) % 2) * 2));
+	}
+	bool bUnwinnable = false;
+	TimeRule(TEXT("IsUnwinnable no moves ") + Size, Iterations, OutResults, [&]()
+	{
+		bUnwinnable = Board.IsUnwinnable();
+	});
+	check(bUnwinnable);
+}
+
+/** Read a save written by FMatch3SaveWriter::SerializeSaveGame into an existing object, the way UGameplayStatics::LoadGameFromSlot does. */
+static void DeserializeSaveGame(const TArray<uint8>& Bytes, UMatch3SaveGame* SaveGameObject)
+{
+	FMemoryReader MemoryReader(Bytes, true);
+	int32 FileTypeTag;
+	int32 SaveGameFileVersion;
+	int32 PackageFileUE4Version;
+	FEngineVersion SavedEngineVersion;
+	FString SaveGameClassName;
+	MemoryReader << FileTypeTag;
+	MemoryReader << SaveGameFileVersion;
+	MemoryReader << PackageFileUE4Version;
+	MemoryReader << SavedEngineVersion;
+	MemoryReader << SaveGameClassName;
+	MemoryReader.SetUE4Ver(PackageFileUE4Version);
+	MemoryReader.SetEngineVer(SavedEngineVersion);
+
+	FObjectAndNameAsStringProxyArchive Ar(MemoryReader, true);
+	SaveGameObject->Serialize(Ar);
+}
+
+void Match3Benchmark::BenchmarkSaveFormats(int32 NumLevels, int32 Iterations, TArray<FMatch3BenchmarkResult>& OutResults)
+{
+	Iterations = FMath::Max(1, Iterations);
+	NumLevels = FMath::Max(1, NumLevels);
+	const FString Size = FString::Printf(TEXT("%d levels"), NumLevels);
+
+	// The same levels and custom fields in both formats.
+	UMatch3SaveGame* LegacySave = NewObject<UMatch3SaveGame>();
+	UMatch3SaveGame* RecordSave = NewObject<UMatch3SaveGame>();
+	FRandomStream RandomStream(0x4D33);
+	for (int32 LevelIndex = 0; LevelIndex < NumLevels; ++LevelIndex)
+	{
+		const FString LevelName = FString::Printf(TEXT("Match3Level_%04d"), LevelIndex);
+		FMatch3LevelSaveData Data;
+		Data.BronzeScore = 1000 * (1 + (LevelIndex % 10));
+		Data.SilverScore = Data.BronzeScore * 2;
+		Data.GoldScore = Data.BronzeScore * 3;
+		Data.TopScore = RandomStream.RandRange(0, Data.GoldScore * 2);
+		LegacySave->Match3SaveData.Add(LevelName, Data);
+		RecordSave->SetLevelData(LevelName, Data);
+	}
+	for (UMatch3SaveGame* SaveGameObject : { LegacySave, RecordSave })
+	{
+		SaveGameObject->SaveCustomInt(TEXT("TutorialSeen"), 1);
+		SaveGameObject->SaveCustomInt(TEXT("MusicVolume"), 80);
+	}
+
+	// The legacy format writes and reads every level each time.
+	TArray<uint8> LegacyBytes;
+	TimeRule(TEXT("Save legacy encode ") + Size, Iterations, OutResults, [&]()
+	{
+		FMatch3SaveWriter::SerializeSaveGame(LegacySave, LegacyBytes);
+	});
+	UMatch3SaveGame* LoadedSave = NewObject<UMatch3SaveGame>();
+	TimeRule(TEXT("Save legacy decode ") + Size, Iterations, OutResults, [&]()
+	{
+		LoadedSave->Match3SaveData.Reset();
+		DeserializeSaveGame(LegacyBytes, LoadedSave);
+	});
+	check(LoadedSave->Match3SaveData.Num() == NumLevels);
+
+	// Records: the object without its levels, plus every shard.
+	TArray<uint8> PropertyBytes;
+	FMatch3SaveWriter::SerializeSaveGame(RecordSave, PropertyBytes);
+	TArray<TArray<uint8>> ShardBytes;
+	ShardBytes.SetNum(FMatch3LevelRecordStore::NumShards);
+	TimeRule(TEXT("Save records encode all ") + Size, Iterations, OutResults, [&]()
+	{
+		for (int32 ShardIndex = 0; ShardIndex < FMatch3LevelRecordStore::NumShards; ++ShardIndex)
+		{
+			RecordSave->LevelRecords.EncodeShard(ShardIndex, ShardBytes[ShardIndex]);
+		}
+	});
+	int32 RecordBytes = PropertyBytes.Num();
+	for (const TArray<uint8>& Bytes : ShardBytes)
+	{
+		RecordBytes += Bytes.Num();
+	}
+	UMatch3SaveGame* LoadedRecordSave = NewObject<UMatch3SaveGame>();
+	FMatch3LevelRecordStore LoadedRecords;
+	TimeRule(TEXT("Save records decode ") + Size, Iterations, OutResults, [&]()
+	{
+		LoadedRecords.Reset();
+		DeserializeSaveGame(PropertyBytes, LoadedRecordSave);
+		for (const TArray<uint8>& Bytes : ShardBytes)
+		{
+			verify(LoadedRecords.DecodeShard(Bytes));
+		}
+	});
+	check(LoadedRecords.Num() == RecordSave->LevelRecords.Num());
+
+	// After a game, only one level's shard needs to be written.
+	FMatch3LevelSaveData ChangedData;
+	RecordSave->FindLevelData(TEXT("Match3Level_0000"), ChangedData);
+	TArray<uint8> ChangedShardBytes;
+	TimeRule(TEXT("Save records encode one ") + Size, Iterations, OutResults, [&]()
+	{
+		++ChangedData.TopScore;
+		RecordSave->SetLevelData(TEXT("Match3Level_0000"), ChangedData);
+		for (int32 ShardIndex = 0; ShardIndex < FMatch3LevelRecordStore::NumShards; ++ShardIndex)
+		{
+			if (RecordSave->LevelRecords.IsShardDirty(ShardIndex))
+			{
+				RecordSave->LevelRecords.EncodeShard(ShardIndex, ChangedShardBytes);
+			}
+		}
+		RecordSave->LevelRecords.ClearDirty();
+	});
+
+	UE_LOG(LogMatch3, Display, TEXT("Save size for %d levels: legacy %d bytes per save; records %d bytes in all, %d bytes to save one level."),
+		NumLevels, LegacyBytes.Num(), RecordBytes, ChangedShardBytes.Num());
+}
+
+FString Match3Benchmark::GetDefaultBaselineFilename()
+{
+	return FPaths::Combine(*FPaths::GameDir(), TEXT("Build"), TEXT("Match3Baseline.txt"));
+}
+
+bool Match3Benchmark::SaveBaseline(const FString& Filename, const TArray<FMatch3BenchmarkResult>& Results)
+{
+	FString BaselineText = TEXT("; Microseconds per iteration of each board rules microbenchmark. Regenerate with: -run=Match3Benchmark -Micro -SaveBaseline=Path\n");
+	for (const FMatch3BenchmarkResult& Result : Results)
+	{
+		BaselineText += FString::Printf(TEXT("%s=%.4f\n"), *Result.Name, Result.SecondsPerIteration * 1000000.0);
+	}
+	if (!FFileHelper::SaveStringToFile(BaselineText, *Filename))
+	{
+		UE_LOG(LogMatch3, Error, TEXT("Couldn't write %s."), *Filename);
+		return false;
+	}
+	UE_LOG(LogMatch3, Display, TEXT("Wrote %d baseline results to %s."), Results.Num(), *Filename);
+	return true;
+}
+
+int32 Match3Benchmark::CompareWithBaseline(const FString& Filename, const TArray<FMatch3BenchmarkResult>& Results, float MaxSlowdown)
+{
+	FString BaselineText;
+	if (!FFileHelper::LoadFileToString(BaselineText, *Filename))
+	{
+		UE_LOG(LogMatch3, Error, TEXT("Couldn't read baseline %s."), *Filename);
+		return INDEX_NONE;
+	}
+	TMap<FString, double> BaselineMicroseconds;
+	TArray<FString> Lines;
+	BaselineText.ParseIntoArrayLines(Lines);
+	for (const FString& Line : Lines)
+	{
+		FString Name, Value;
+		if (!Line.StartsWith(TEXT(";")) && Line.Split(TEXT("="), &Name, &Value, ESearchCase::CaseSensitive, ESearchDir::FromEnd))
+		{
+			BaselineMicroseconds.Add(Name.Trim().TrimTrailing(), FCString::Atod(*Value));
+		}
+	}
+
+	int32 NumRegressions = 0;
+	UE_LOG(LogMatch3, Display, TEXT("Compared with %s, failing above %.0f%% slower:"), *Filename, MaxSlowdown * 100.0f);
+	for (const FMatch3BenchmarkResult& Result : Results)
+	{
+		const double Microseconds = Result.SecondsPerIteration * 1000000.0;
+		const double* Baseline = BaselineMicroseconds.Find(Result.Name);
+		if (!Baseline || (*Baseline <= 0.0))
+		{
+			UE_LOG(LogMatch3, Warning, TEXT("  %-32s %10.3f us  (no baseline)"), *Result.Name, Microseconds);
+			continue;
+		}
+		const double Change = (Microseconds / *Baseline) - 1.0;
+		if (Change > MaxSlowdown)
+		{
+			++NumRegressions;
+			UE_LOG(LogMatch3, Error, TEXT("  %-32s %10.3f us  baseline %10.3f us  %+6.1f%%  REGRESSED"), *Result.Name, Microseconds, *Baseline, Change * 100.0);
+		}
+		else
+		{
+			UE_LOG(LogMatch3, Display, TEXT("  %-32s %10.3f us  baseline %10.3f us  %+6.1f%%"), *Result.Name, Microseconds, *Baseline, Change * 100.0);
+		}
+	}
+	if (NumRegressions > 0)
+	{
+		UE_LOG(LogMatch3, Error, TEXT("%d results slowed down by more than %.0f%%."), NumRegressions, MaxSlowdown * 100.0f);
+	}
+	return NumRegressions;
+}
+
+FString Match3Benchmark::GetMapNameFromParams(const FString& Params)
+{
+	FString MapName;
+	if (!FParse::Value(*Params, TEXT("Map="), MapName))
+	{
+		GConfig->GetString(TEXT("/Script/EngineSettings.GameMapsSettings"), TEXT("GameDefaultMap"), MapName, GEngineIni);
+	}
+	return MapName;
+}
+
+bool Match3Benchmark::LoadLevelSettings(const FString& MapName, FMatch3GameSettings& OutSettings, const AMatch3GameMode** OutGameModeCDO)
+{
+	UPackage* Package = LoadPackage(nullptr, *MapName, LOAD_None);
+	UWorld* World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+	AGrid* Grid = nullptr;
+	if (World && World->PersistentLevel)
+	{
+		for (AActor* Actor : World->PersistentLevel->Actors)
+		{
+			Grid = Cast<AGrid>(Actor);
+			if (Grid)
+			{
+				break;
+			}
+		}
+	}
+	if (!Grid)
+	{
+		UE_LOG(LogMatch3, Error, TEXT("Couldn't find a grid in %s."), *MapName);
+		return false;
+	}
+	Grid->GetGameSettings(OutSettings);
+
+	// Nothing is running, so read the defaults of the classes the level would spawn.
+	const AGameModeBase* GameModeCDO = nullptr;
+	if (const AWorldSettings* WorldSettings = World->GetWorldSettings())
+	{
+		GameModeCDO = WorldSettings->DefaultGameMode ? WorldSettings->DefaultGameMode->GetDefaultObject<AGameModeBase>() : nullptr;
+	}
+	const AMatch3PlayerController* PlayerControllerCDO = nullptr;
+	if (GameModeCDO && GameModeCDO->PlayerControllerClass)
+	{
+		PlayerControllerCDO = Cast<AMatch3PlayerController>(GameModeCDO->PlayerControllerClass->GetDefaultObject());
+	}
+	if (!PlayerControllerCDO)
+	{
+		PlayerControllerCDO = GetDefault<AMatch3PlayerController>();
+	}
+	OutSettings.InitialComboPower = PlayerControllerCDO->ComboPower;
+	OutSettings.MaxComboPower = PlayerControllerCDO->MaxComboPower;
+	if (OutGameModeCDO)
+	{
+		*OutGameModeCDO = Cast<AMatch3GameMode>(GameModeCDO);
+	}
+	return true;
+}
+
+void Match3Benchmark::RunSelfPlay(const FMatch3GameSettings& Settings, FMatch3BotPolicy& Policy, int32 NumGames, int32 MaxMovesPerGame, int32 Seed, FMatch3SelfPlayResult& OutResult)
+{
+	OutResult = FMatch3SelfPlayResult();
+	FMatch3HeadlessGame Game;
+	Game.SetCollectPhaseTimes(true);
+	FRandomStream BotRandomStream(Seed);
+	FMatch3BotMove Move;
+	OutResult.Games.Reserve(NumGames);
+
+	FMatch3ScopedAllocationCounter AllocationCounter;
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 GameIndex = 0; GameIndex < NumGames; ++GameIndex)
+	{
+		Game.Init(Settings, Seed + GameIndex);
+		while (!Game.IsGameOver() && (Game.GetNumMoves() < MaxMovesPerGame) && Policy.ChooseMove(Game, BotRandomStream, Move))
+		{
+			FMatch3BotPolicy::PlayMove(Game, Move);
+		}
+
+		++OutResult.NumGames;
+		OutResult.NumMoves += Game.GetNumMoves();
+		OutResult.NumMatches += Game.GetNumMatches();
+		OutResult.NumCascades += Game.GetNumCascades();
+		OutResult.NumDeadlocks += Game.IsGameOver() ? 1 : 0;
+		OutResult.TotalScore += Game.GetScore();
+		OutResult.PhaseTimes += Game.GetPhaseTimes();
+
+		FMatch3SelfPlayGame& GameResult = OutResult.Games[OutResult.Games.AddUninitialized()];
+		GameResult.Seed = Seed + GameIndex;
+		GameResult.NumMoves = Game.GetNumMoves();
+		GameResult.NumMatches = Game.GetNumMatches();
+		GameResult.NumCascades = Game.GetNumCascades();
+		GameResult.MaxCascadeDepth = Game.GetMaxCascadeDepth();
+		GameResult.NumTilesSpawned = Game.GetNumTilesSpawned();
+		GameResult.NumReshuffles = Game.GetNumReshuffles();
+		GameResult.Score = Game.GetScore();
+		GameResult.bDeadlocked = Game.IsGameOver();
+		GameResult.PhaseTimes = Game.GetPhaseTimes();
+	}
+	OutResult.Seconds = FPlatformTime::Seconds() - StartTime;
+	OutResult.NumAllocations = AllocationCounter.GetNumAllocations();
+	OutResult.NumReallocations = AllocationCounter.GetNumReallocations();
+}
+
+void Match3Benchmark::LogSelfPlayResult(const FString& Title, const FMatch3SelfPlayResult& Result)
+{
+	const double Seconds = FMath::Max(Result.Seconds, SMALL_NUMBER);
+	const int32 NumMoves = FMath::Max(Result.NumMoves, 1);
+	UE_LOG(LogMatch3, Display, TEXT("%s"), *Title);
+	UE_LOG(LogMatch3, Display, TEXT("  %d games, %d moves, %d matches, %d cascades, %d deadlocks, average score %.1f"),
+		Result.NumGames, Result.NumMoves, Result.NumMatches, Result.NumCascades, Result.NumDeadlocks, (double)Result.TotalScore / FMath::Max(Result.NumGames, 1));
+	UE_LOG(LogMatch3, Display, TEXT("  %.3f s total, %.1f moves/s, %.1f cascades/s"), Result.Seconds, Result.NumMoves / Seconds, Result.NumCascades / Seconds);
+
+	const struct
+	{
+		const TCHAR* Name;
+		double Seconds;
+	} Phases[] =
+	{
+		{ TEXT("Matching"), Result.PhaseTimes.Matching },
+		{ TEXT("Gravity"), Result.PhaseTimes.Gravity },
+		{ TEXT("Refill"), Result.PhaseTimes.Refill },
+		{ TEXT("Deadlock check"), Result.PhaseTimes.DeadlockCheck },
+	};
+	for (const auto& Phase : Phases)
+	{
+		UE_LOG(LogMatch3, Display, TEXT("  %-16s %10.3f ms  %5.1f%%  %8.3f us/move"), Phase.Name, Phase.Seconds * 1000.0, 100.0 * Phase.Seconds / Seconds, Phase.Seconds * 1000000.0 / NumMoves);
+	}
+	UE_LOG(LogMatch3, Display, TEXT("  %llu allocations (%.2f per move), %llu reallocations"), Result.NumAllocations, (double)Result.NumAllocations / NumMoves, Result.NumReallocations);
+}
+
+bool Match3Benchmark::SaveSelfPlayCsv(const FString& Filename, const FMatch3SelfPlayResult& Result)
+{
+	FString Csv = TEXT("Seed,Moves,Matches,Cascades,MaxCascadeDepth,TilesSpawned,Reshuffles,Score,Deadlocked,MatchingMs,GravityMs,RefillMs,DeadlockCheckMs\n");
+	for (const FMatch3SelfPlayGame& Game : Result.Games)
+	{
+		Csv += FString::Printf(TEXT("%d,%d,%d,%d,%d,%d,%d,%d,%d,%.4f,%.4f,%.4f,%.4f\n"), Game.Seed, Game.NumMoves, Game.NumMatches, Game.NumCascades, Game.MaxCascadeDepth,
+			Game.NumTilesSpawned, Game.NumReshuffles, Game.Score, Game.bDeadlocked ? 1 : 0,
+			Game.PhaseTimes.Matching * 1000.0, Game.PhaseTimes.Gravity * 1000.0, Game.PhaseTimes.Refill * 1000.0, Game.PhaseTimes.DeadlockCheck * 1000.0);
+	}
+	if (!FFileHelper::SaveStringToFile(Csv, *Filename))
+	{
+		UE_LOG(LogMatch3, Error, TEXT("Couldn't write %s."), *Filename);
+		return false;
+	}
+	UE_LOG(LogMatch3, Display, TEXT("Wrote %d games to %s."), Result.Games.Num(), *Filename);
+	return true;
+}
+
+void Match3Benchmark::LogResults(const FString& Title, const TArray<FMatch3BenchmarkResult>& Results)
+{
+	UE_LOG(LogMatch3, Display, TEXT("%s"), *Title);
+	for (const FMatch3BenchmarkResult& Result : Results)
+	{
+		UE_LOG(LogMatch3, Display, TEXT("  %-32s %10.3f us  (%d iterations)"), *Result.Name, Result.SecondsPerIteration * 1000000.0, Result.Iterations);
+	}
+}
+
+static void RunMatchDetectionBenchmark(const TArray<FString>& Args)
+{
+	const int32 Iterations = (Args.Num() > 0) ? FCString::Atoi(*Args[0]) : 1000;
+	const int32 NumTileTypes = (Args.Num() > 1) ? FCString::Atoi(*Args[1]) : 6;
+
+	// The board we ship, a large board, and the widest board a single bitboard row can hold.
+	const FIntPoint BoardSizes[] = { FIntPoint(8, 8), FIntPoint(32, 32), FIntPoint(64, 64) };
+	TArray<FMatch3BenchmarkResult> Results;
+	for (const FIntPoint& BoardSize : BoardSizes)
+	{
+		Match3Benchmark::BenchmarkMatchDetection(BoardSize.X, BoardSize.Y, NumTileTypes, Iterations, Results);
+	}
+	Match3Benchmark::LogResults(TEXT("Match detection"), Results);
+}
+
+static FAutoConsoleCommand BenchmarkMatchDetectionCommand(
+	TEXT("Match3.Benchmark.MatchDetection"),
+	TEXT("Times whole-board match detection with FindNeighbors against bitboards. Arguments: [Iterations] [NumTileTypes]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&RunMatchDetectionBenchmark));
+
+static void RunSaveFormatBenchmark(const TArray<FString>& Args)
+{
+	const int32 NumLevels = (Args.Num() > 0) ? FCString::Atoi(*Args[0]) : 500;
+	const int32 Iterations = (Args.Num() > 1) ? FCString::Atoi(*Args[1]) : 100;
+	TArray<FMatch3BenchmarkResult> Results;
+	Match3Benchmark::BenchmarkSaveFormats(NumLevels, Iterations, Results);
+	Match3Benchmark::LogResults(TEXT("Save formats"), Results);
+}
+
+static FAutoConsoleCommand BenchmarkSaveFormatCommand(
+	TEXT("Match3.Benchmark.SaveFormat"),
+	TEXT("Times encoding and decoding saved level data in the legacy save format against per-level records, and logs the sizes. Arguments: [NumLevels] [Iterations]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&RunSaveFormatBenchmark));
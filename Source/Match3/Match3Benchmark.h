@@ -0,0 +1,164 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Match3Board.h"
+#include "Match3HeadlessGame.h"
+
+class FMatch3BotPolicy;
+
+/** Timing for one benchmarked code path. */
+struct FMatch3BenchmarkResult
+{
+	/** Short name of the code path that was timed. */
+	FString Name;
+
+	/** Number of times the code path was run. */
+	int32 Iterations;
+
+	/** Average wall time for one run, in seconds. */
+	double SecondsPerIteration;
+
+	FMatch3BenchmarkResult()
+		: Iterations(0)
+		, SecondsPerIteration(0.0)
+	{
+	}
+};
+
+/** Counters from one bot-played headless game. */
+struct FMatch3SelfPlayGame
+{
+	int32 Seed;
+	int32 NumMoves;
+	int32 NumMatches;
+	int32 NumCascades;
+	int32 MaxCascadeDepth;
+	int32 NumTilesSpawned;
+	int32 NumReshuffles;
+	int32 Score;
+	bool bDeadlocked;
+	FMatch3GamePhaseTimes PhaseTimes;
+};
+
+/** Totals from a batch of bot-played headless games. */
+struct FMatch3SelfPlayResult
+{
+	int32 NumGames;
+	int32 NumMoves;
+	int32 NumMatches;
+	int32 NumCascades;
+	/** Games that ended because the board had no moves left, rather than by reaching the move limit. */
+	int32 NumDeadlocks;
+	int64 TotalScore;
+
+	/** Wall time for the whole batch, including the bot choosing moves. */
+	double Seconds;
+	/** Time spent resolving moves, by stage. */
+	FMatch3GamePhaseTimes PhaseTimes;
+
+	/** Heap allocations and reallocations made on any thread while the batch ran. */
+	uint64 NumAllocations;
+	uint64 NumReallocations;
+
+	/** Each game in the order it was played. */
+	TArray<FMatch3SelfPlayGame> Games;
+
+	FMatch3SelfPlayResult()
+		: NumGames(0)
+		, NumMoves(0)
+		, NumMatches(0)
+		, NumCascades(0)
+		, NumDeadlocks(0)
+		, TotalScore(0)
+		, Seconds(0.0)
+		, NumAllocations(0)
+		, NumReallocations(0)
+	{
+	}
+};
+
+/**
+ * Counts heap allocations for as long as it exists, by standing in for GMalloc and passing every call through to it.
+ * Only one can be active at a time, and it must be created and destroyed on the game thread while no other thread is starting up or shutting down.
+ */
+class MATCH3_API FMatch3ScopedAllocationCounter : public FMalloc
+{
+public:
+	FMatch3ScopedAllocationCounter();
+	virtual ~FMatch3ScopedAllocationCounter();
+
+	uint64 GetNumAllocations() const { return (uint64)NumAllocations; }
+	uint64 GetNumReallocations() const { return (uint64)NumReallocations; }
+
+	// FMalloc interface.
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment = DEFAULT_ALIGNMENT) override;
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment = DEFAULT_ALIGNMENT) override;
+	virtual void Free(void* Original) override;
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return InnerMalloc->QuantizeSize(Count, Alignment); }
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return InnerMalloc->GetAllocationSize(Original, SizeOut); }
+	virtual void Trim() override { InnerMalloc->Trim(); }
+	virtual bool IsInternallyThreadSafe() const override { return InnerMalloc->IsInternallyThreadSafe(); }
+	virtual bool ValidateHeap() override { return InnerMalloc->ValidateHeap(); }
+	virtual const TCHAR* GetDescriptiveName() override { return TEXT("Match3AllocationCounter"); }
+
+private:
+	FMalloc* InnerMalloc;
+	volatile int64 NumAllocations;
+	volatile int64 NumReallocations;
+};
+
+/** Microbenchmarks for the board rules. These run on plain board data and don't need a world. */
+namespace Match3Benchmark
+{
+	/** Fill a board with uniformly random tile types from a fixed seed. Runs are left in place so there is something to find. */
+	MATCH3_API void FillRandomBoard(FMatch3Board& Board, int32 Width, int32 Height, int32 NumTileTypes, int32 MinimumRunLength, int32 Seed);
+
+	/** Time whole-board match detection with a FindNeighbors call per tile against the bitboard path. Both paths are checked for identical results. */
+	MATCH3_API bool BenchmarkMatchDetection(int32 Width, int32 Height, int32 NumTileTypes, int32 Iterations, TArray<FMatch3BenchmarkResult>& OutResults);
+
+	/**
+	 * Time the rules that a move runs through on a board of the given size: FindNeighbors at every space, IsMoveLegal for every pair of neighbors,
+	 * GetExplosionList for every bomb, resolving a cascade, and IsUnwinnable on a board with no moves, which has to check every pair.
+	 */
+	MATCH3_API void BenchmarkRules(int32 Width, int32 Height, int32 NumTileTypes, int32 Iterations, TArray<FMatch3BenchmarkResult>& OutResults);
+
+	/**
+	 * Time encoding and decoding the saved data for NumLevels levels in the legacy format, where every save holds every level, against per-level records.
+	 * Only serialization is timed, not disk access. Sizes are written to the log.
+	 */
+	MATCH3_API void BenchmarkSaveFormats(int32 NumLevels, int32 Iterations, TArray<FMatch3BenchmarkResult>& OutResults);
+
+	/** The baseline committed with the project, which -Micro runs of the benchmark commandlet are compared with by default. */
+	MATCH3_API FString GetDefaultBaselineFilename();
+
+	/** Write results to a baseline file, one "Name=Microseconds" line each, after a comment saying how to regenerate it. Lines starting with ';' are comments. */
+	MATCH3_API bool SaveBaseline(const FString& Filename, const TArray<FMatch3BenchmarkResult>& Results);
+
+	/**
+	 * Compare results against a baseline file written by SaveBaseline, logging each one. Results missing from the baseline are reported but don't fail.
+	 * Returns the number of results that took more than (1 + MaxSlowdown) times their baseline, or INDEX_NONE if the baseline couldn't be read.
+	 */
+	MATCH3_API int32 CompareWithBaseline(const FString& Filename, const TArray<FMatch3BenchmarkResult>& Results, float MaxSlowdown);
+
+	/** Read -Map= from commandlet parameters, falling back to the project's default map. */
+	MATCH3_API FString GetMapNameFromParams(const FString& Params);
+
+	/**
+	 * Load a level without starting it and describe its grid's game. Combo settings come from the player controller that the level's game mode would spawn.
+	 * If OutGameModeCDO is given, it receives the default object of the level's game mode, or null if it isn't an AMatch3GameMode.
+	 */
+	MATCH3_API bool LoadLevelSettings(const FString& MapName, FMatch3GameSettings& OutSettings, const class AMatch3GameMode** OutGameModeCDO = nullptr);
+
+	/** Play NumGames headless games with a bot, each until it deadlocks or reaches MaxMovesPerGame. Game N is seeded with Seed + N. */
+	MATCH3_API void RunSelfPlay(const FMatch3GameSettings& Settings, FMatch3BotPolicy& Policy, int32 NumGames, int32 MaxMovesPerGame, int32 Seed, FMatch3SelfPlayResult& OutResult);
+
+	/** Write self-play totals and rates to the log. */
+	MATCH3_API void LogSelfPlayResult(const FString& Title, const FMatch3SelfPlayResult& Result);
+
+	/** Write one row per game to a CSV file, with the counters and stage times that stat Match3 shows in game. */
+	MATCH3_API bool SaveSelfPlayCsv(const FString& Filename, const FMatch3SelfPlayResult& Result);
+
+	/** Write results to the log. */
+	MATCH3_API void LogResults(const FString& Title, const TArray<FMatch3BenchmarkResult>& Results);
+}
@@ -0,0 +1,90 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "Match3.h"
+#include "Match3BenchmarkCommandlet.h"
+#include "Match3Benchmark.h"
+#include "Match3BotPolicy.h"
+
+UMatch3BenchmarkCommandlet::UMatch3BenchmarkCommandlet(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	IsClient = false;
+	IsServer = false;
+	LogToConsole = true;
+	HelpDescription = TEXT("Plays headless games of a level's grid with a bot and reports moves per second, time per stage and allocation counts. With -Micro, times the board rules and fails if any is slower than the baseline in Build/Match3Baseline.txt.");
+	HelpUsage = TEXT("-run=Match3Benchmark [-Map=/Game/Maps/Name] [-Games=100] [-MaxMoves=500] [-Policy=Random|First|Greedy] [-Seed=1] [-Csv=Path]")
+		TEXT(" | -Micro [-Iterations=100] [-Baseline=Path] [-MaxSlowdown=0.25] [-SaveBaseline=Path]");
+}
+
+/** Time the board rules on generated boards. Returns the commandlet's exit code. */
+static int32 RunMicrobenchmarks(const FString& Params)
+{
+	int32 Iterations = 100;
+	float MaxSlowdown = 0.25f;
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	FParse::Value(*Params, TEXT("MaxSlowdown="), MaxSlowdown);
+
+	// The board we ship, a large board, and one too wide for bitboards.
+	const FIntPoint BoardSizes[] = { FIntPoint(8, 8), FIntPoint(32, 32), FIntPoint(128, 128) };
+	TArray<FMatch3BenchmarkResult> Results;
+	for (const FIntPoint& BoardSize : BoardSizes)
+	{
+		Match3Benchmark::BenchmarkRules(BoardSize.X, BoardSize.Y, 6, Iterations, Results);
+	}
+	Match3Benchmark::LogResults(TEXT("Board rules"), Results);
+
+	// Writing a new baseline replaces the old one, so there is nothing to compare against.
+	FString BaselineFilename;
+	if (FParse::Value(*Params, TEXT("SaveBaseline="), BaselineFilename))
+	{
+		return Match3Benchmark::SaveBaseline(BaselineFilename, Results) ? 0 : 1;
+	}
+	if (!FParse::Value(*Params, TEXT("Baseline="), BaselineFilename))
+	{
+		BaselineFilename = Match3Benchmark::GetDefaultBaselineFilename();
+	}
+	return (Match3Benchmark::CompareWithBaseline(BaselineFilename, Results, MaxSlowdown) != 0) ? 1 : 0;
+}
+
+int32 UMatch3BenchmarkCommandlet::Main(const FString& Params)
+{
+	// Microbenchmarks run on generated boards, so they don't need a level.
+	if (FParse::Param(*Params, TEXT("Micro")))
+	{
+		return RunMicrobenchmarks(Params);
+	}
+
+	const FString MapName = Match3Benchmark::GetMapNameFromParams(Params);
+	int32 NumGames = 100;
+	int32 MaxMoves = 500;
+	int32 Seed = 1;
+	FString PolicyName = TEXT("Greedy");
+	FParse::Value(*Params, TEXT("Games="), NumGames);
+	FParse::Value(*Params, TEXT("MaxMoves="), MaxMoves);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("Policy="), PolicyName);
+
+	TSharedPtr<FMatch3BotPolicy> Policy = FMatch3BotPolicy::Create(PolicyName);
+	if (!Policy.IsValid())
+	{
+		UE_LOG(LogMatch3, Error, TEXT("Unknown bot policy %s. %s"), *PolicyName, *HelpUsage);
+		return 1;
+	}
+
+	FMatch3GameSettings Settings;
+	if (!Match3Benchmark::LoadLevelSettings(MapName, Settings))
+	{
+		return 1;
+	}
+
+	FMatch3SelfPlayResult Result;
+	Match3Benchmark::RunSelfPlay(Settings, *Policy, FMath::Max(NumGames, 1), FMath::Max(MaxMoves, 1), Seed, Result);
+	Match3Benchmark::LogSelfPlayResult(FString::Printf(TEXT("%s: %dx%d, %d tile types, %s bot"), *MapName, Settings.Width, Settings.Height, Settings.TileTypes.Num(), Policy->GetName()), Result);
+
+	FString CsvFilename;
+	if (FParse::Value(*Params, TEXT("Csv="), CsvFilename) && !Match3Benchmark::SaveSelfPlayCsv(CsvFilename, Result))
+	{
+		return 1;
+	}
+	return 0;
+}
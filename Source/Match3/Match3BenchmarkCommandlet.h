@@ -0,0 +1,24 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "Match3BenchmarkCommandlet.generated.h"
+
+/**
+ * Plays headless games of a level's grid with a bot and reports how fast the game rules run.
+ * Example: UE4Editor-Cmd UnrealMatch3.uproject -run=Match3Benchmark -Map=/Game/Maps/Match3 -Games=200 -Policy=Greedy -nullrhi
+ * Microbenchmarks: UE4Editor-Cmd UnrealMatch3.uproject -run=Match3Benchmark -Micro -nullrhi
+ * These are compared with the baseline in Build/Match3Baseline.txt, or the file given by -Baseline=Path. Timings depend on the machine, so after changing
+ * the rules on purpose, or to check on a new machine, regenerate it there with -Micro -SaveBaseline=Build/Match3Baseline.txt and commit the result.
+ */
+UCLASS()
+class UMatch3BenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMatch3BenchmarkCommandlet(const FObjectInitializer& ObjectInitializer);
+
+	virtual int32 Main(const FString& Params) override;
+};
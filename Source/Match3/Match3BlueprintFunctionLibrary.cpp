@@ -2,6 +2,7 @@
 
 #include "Match3.h"
 #include "Match3GameMode.h"
+#include "Match3SessionContext.h"
 #include "Match3BlueprintFunctionLibrary.h"
 
 APlayerController* UMatch3BlueprintFunctionLibrary::GetLocalPlayerController(UObject* WorldContextObject)
@@ -32,7 +33,7 @@ FString UMatch3BlueprintFunctionLibrary::GetOnlineAccountID(APlayerController* P
 
 bool UMatch3BlueprintFunctionLibrary::IsGameActive(UObject* WorldContextObject)
 {
-	if (AMatch3GameMode* GameMode = Cast<AMatch3GameMode>(UGameplayStatics::GetGameMode(WorldContextObject)))
+	if (AMatch3GameMode* GameMode = FMatch3SessionContext::GetGameMode(WorldContextObject))
 	{
 		if (GameMode->IsGameActive())
 		{
@@ -44,7 +45,7 @@ bool UMatch3BlueprintFunctionLibrary::IsGameActive(UObject* WorldContextObject)
 
 void UMatch3BlueprintFunctionLibrary::PauseGameTimer(UObject* WorldContextObject, bool bPause)
 {
-	if (AMatch3GameMode* GameMode = Cast<AMatch3GameMode>(UGameplayStatics::GetGameMode(WorldContextObject)))
+	if (AMatch3GameMode* GameMode = FMatch3SessionContext::GetGameMode(WorldContextObject))
 	{
 		GameMode->PauseGameTimer(bPause);
 	}
@@ -0,0 +1,893 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "Match3.h"
+#include "Match3Board.h"
+
+DECLARE_CYCLE_STAT(TEXT("Board FindNeighbors"), STAT_Match3BoardFindNeighbors, STATGROUP_Match3);
+DECLARE_CYCLE_STAT(TEXT("Board FindMatches"), STAT_Match3BoardFindMatches, STATGROUP_Match3);
+DECLARE_CYCLE_STAT(TEXT("Board FindCascadeMatches"), STAT_Match3BoardFindCascadeMatches, STATGROUP_Match3);
+DECLARE_CYCLE_STAT(TEXT("Board IsMoveLegal"), STAT_Match3BoardIsMoveLegal, STATGROUP_Match3);
+DECLARE_CYCLE_STAT(TEXT("Board IsUnwinnable"), STAT_Match3BoardIsUnwinnable, STATGROUP_Match3);
+
+void FMatch3BoardMask::Init(int32 Height)
+{
+	Rows.Reset(Height);
+	Rows.AddZeroed(Height);
+}
+
+bool FMatch3BoardMask::IsEmpty() const
+{
+	for (uint64 Row : Rows)
+	{
+		if (Row)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int32 FMatch3BoardMask::Num() const
+{
+	int32 Count = 0;
+	for (uint64 Row : Rows)
+	{
+		// Clear the lowest set bit until none are left.
+		for (; Row; Row &= (Row - 1))
+		{
+			++Count;
+		}
+	}
+	return Count;
+}
+
+void FMatch3BoardMask::GetGridAddresses(int32 Width, TArray<int32>& OutGridAddresses) const
+{
+	OutGridAddresses.Reset();
+	for (int32 Y = 0; Y < Rows.Num(); ++Y)
+	{
+		for (uint64 Row = Rows[Y]; Row; Row &= (Row - 1))
+		{
+			// Isolate the lowest set bit. Its index is the column.
+			const uint64 LowestBit = Row & (~Row + 1);
+			OutGridAddresses.Add((Y * Width) + (int32)FMath::FloorLog2_64(LowestBit));
+		}
+	}
+}
+
+FMatch3AddressSet::FMatch3AddressSet()
+	: Count(0)
+{
+}
+
+void FMatch3AddressSet::Init(int32 NumSpaces)
+{
+	Words.Reset((NumSpaces + 63) >> 6);
+	Words.AddZeroed((NumSpaces + 63) >> 6);
+	Count = 0;
+}
+
+void FMatch3AddressSet::Reset()
+{
+	if (Count > 0)
+	{
+		FMemory::Memzero(Words.GetData(), Words.Num() * Words.GetTypeSize());
+		Count = 0;
+	}
+}
+
+bool FMatch3AddressSet::Add(int32 GridAddress)
+{
+	uint64& Word = Words[GridAddress >> 6];
+	const uint64 Bit = 1ull << (GridAddress & 63);
+	if (Word & Bit)
+	{
+		return false;
+	}
+	Word |= Bit;
+	++Count;
+	return true;
+}
+
+void FMatch3AddressSet::Append(const TArray<int32>& GridAddresses)
+{
+	for (int32 GridAddress : GridAddresses)
+	{
+		Add(GridAddress);
+	}
+}
+
+bool FMatch3AddressSet::Remove(int32 GridAddress)
+{
+	uint64& Word = Words[GridAddress >> 6];
+	const uint64 Bit = 1ull << (GridAddress & 63);
+	if (!(Word & Bit))
+	{
+		return false;
+	}
+	Word &= ~Bit;
+	--Count;
+	return true;
+}
+
+void FMatch3AddressSet::Union(const FMatch3AddressSet& Other)
+{
+	check(Words.Num() == Other.Words.Num());
+	for (int32 WordIndex = 0; WordIndex < Words.Num(); ++WordIndex)
+	{
+		Words[WordIndex] |= Other.Words[WordIndex];
+	}
+	UpdateCount();
+}
+
+void FMatch3AddressSet::Intersect(const FMatch3AddressSet& Other)
+{
+	check(Words.Num() == Other.Words.Num());
+	for (int32 WordIndex = 0; WordIndex < Words.Num(); ++WordIndex)
+	{
+		Words[WordIndex] &= Other.Words[WordIndex];
+	}
+	UpdateCount();
+}
+
+void FMatch3AddressSet::UpdateCount()
+{
+	Count = 0;
+	for (uint64 Word : Words)
+	{
+		// Clear the lowest set bit until none are left.
+		for (; Word; Word &= (Word - 1))
+		{
+			++Count;
+		}
+	}
+}
+
+void FMatch3AddressSet::GetGridAddresses(TArray<int32>& OutGridAddresses) const
+{
+	OutGridAddresses.Reset(Count);
+	for (int32 WordIndex = 0; WordIndex < Words.Num(); ++WordIndex)
+	{
+		for (uint64 Word = Words[WordIndex]; Word; Word &= (Word - 1))
+		{
+			// Isolate the lowest set bit. Its index is the address within this word.
+			const uint64 LowestBit = Word & (~Word + 1);
+			OutGridAddresses.Add((WordIndex << 6) + (int32)FMath::FloorLog2_64(LowestBit));
+		}
+	}
+}
+
+FMatch3Board::FMatch3Board()
+	: Width(0)
+	, Height(0)
+	, MinimumRunLength(3)
+	, bDirty(false)
+{
+}
+
+void FMatch3Board::Init(int32 InWidth, int32 InHeight, int32 InMinimumRunLength)
+{
+	check(InWidth > 0);
+	check(InHeight > 0);
+	Width = InWidth;
+	Height = InHeight;
+	MinimumRunLength = InMinimumRunLength;
+
+	TileTypes.Reset(Width * Height);
+	TileTypes.AddUninitialized(Width * Height);
+	FMemory::Memset(TileTypes.GetData(), EmptyTile, TileTypes.Num());
+
+	TileStates.Reset(Width * Height);
+	TileStates.AddZeroed(Width * Height);
+
+	DirtyMinY.SetNum(Width);
+	DirtyMaxY.SetNum(Width);
+	MarkAllDirty();
+}
+
+void FMatch3Board::SetTileTypes(const TArray<FMatch3BoardTileType>& InTileTypes)
+{
+	// Type IDs are stored as bytes, with one value reserved for empty spaces.
+	check(InTileTypes.Num() < EmptyTile);
+	TypeLibrary = InTileTypes;
+}
+
+bool FMatch3Board::GetGridAddressWithOffset(int32 InitialGridAddress, int32 XOffset, int32 YOffset, int32& ReturnGridAddress) const
+{
+	// Initialize to an invalid address.
+	ReturnGridAddress = -1;
+
+	check(Width > 0);
+	const int32 NewX = (InitialGridAddress % Width) + XOffset;
+	const int32 NewY = (InitialGridAddress / Width) + YOffset;
+	if ((NewX < 0) || (NewX >= Width) || (NewY < 0) || (NewY >= Height))
+	{
+		return false;
+	}
+
+	ReturnGridAddress = NewX + (NewY * Width);
+	return true;
+}
+
+bool FMatch3Board::AreAddressesNeighbors(int32 GridAddressA, int32 GridAddressB) const
+{
+	if (IsValidAddress(GridAddressA) && IsValidAddress(GridAddressB))
+	{
+		// Addresses one apart are only neighbors if they are in the same row, not at the end of one row and the start of the next.
+		const int32 GridAddressOffset = FMath::Abs(GridAddressA - GridAddressB);
+		return (((GridAddressOffset == 1) && ((GridAddressA / Width) == (GridAddressB / Width))) || (GridAddressOffset == Width));
+	}
+	return false;
+}
+
+int32 FMatch3Board::GetTileType(int32 GridAddress) const
+{
+	const uint8 TileType = TileTypes[GridAddress];
+	return (TileType == EmptyTile) ? INDEX_NONE : (int32)TileType;
+}
+
+bool FMatch3Board::CanExplode(int32 GridAddress) const
+{
+	const uint8 TileType = TileTypes[GridAddress];
+	return (TileType != EmptyTile) && TypeLibrary[TileType].CanExplode();
+}
+
+bool FMatch3Board::CanSwap(int32 GridAddress) const
+{
+	const uint8 TileType = TileTypes[GridAddress];
+	return (TileType != EmptyTile) && TypeLibrary[TileType].CanSwap();
+}
+
+void FMatch3Board::SetTile(int32 GridAddress, int32 TileTypeID, ETileState::Type NewState)
+{
+	checkSlow(TypeLibrary.IsValidIndex(TileTypeID));
+	TileTypes[GridAddress] = (uint8)TileTypeID;
+	TileStates[GridAddress] = (uint8)NewState;
+	MarkDirty(GridAddress);
+}
+
+void FMatch3Board::ClearTile(int32 GridAddress)
+{
+	TileTypes[GridAddress] = EmptyTile;
+	TileStates[GridAddress] = (uint8)ETileState::ETS_Normal;
+	MarkDirty(GridAddress);
+}
+
+void FMatch3Board::SwapTiles(int32 GridAddressA, int32 GridAddressB)
+{
+	Swap(TileTypes[GridAddressA], TileTypes[GridAddressB]);
+	Swap(TileStates[GridAddressA], TileStates[GridAddressB]);
+	MarkDirty(GridAddressA);
+	MarkDirty(GridAddressB);
+}
+
+bool FMatch3Board::GetDirtyRows(int32 X, int32& OutMinY, int32& OutMaxY) const
+{
+	OutMinY = DirtyMinY[X];
+	OutMaxY = DirtyMaxY[X];
+	return (OutMinY <= OutMaxY);
+}
+
+void FMatch3Board::MarkAllDirty()
+{
+	for (int32 X = 0; X < Width; ++X)
+	{
+		DirtyMinY[X] = 0;
+		DirtyMaxY[X] = Height - 1;
+	}
+	bDirty = true;
+}
+
+void FMatch3Board::ClearDirtyRegion()
+{
+	for (int32 X = 0; X < Width; ++X)
+	{
+		DirtyMinY[X] = Height;
+		DirtyMaxY[X] = -1;
+	}
+	bDirty = false;
+}
+
+bool FMatch3Board::WouldCompleteRun(int32 GridAddress, int32 TileTypeID) const
+{
+	const int32 X = GridAddress % Width;
+	const int32 Y = GridAddress / Width;
+
+	// Check to the left, then check below. Spaces to the right and above haven't been filled yet.
+	for (int32 Horizontal = 0; Horizontal < 2; ++Horizontal)
+	{
+		if ((Horizontal ? X : Y) < (MinimumRunLength - 1))
+		{
+			// This tile is too close to the edge to complete a run along this axis.
+			continue;
+		}
+		const int32 Step = Horizontal ? 1 : Width;
+		int32 TileOffset;
+		for (TileOffset = 1; TileOffset < MinimumRunLength; ++TileOffset)
+		{
+			if (TileTypes[GridAddress - (TileOffset * Step)] != TileTypeID)
+			{
+				break;
+			}
+		}
+		if (TileOffset == MinimumRunLength)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void FMatch3Board::FindNeighbors(int32 StartingGridAddress, TArray<int32>& OutGridAddresses, bool bMustMatchID /* = true */, int32 RunLength /* = -1 */) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_Match3BoardFindNeighbors);
+	OutGridAddresses.Reset();
+	FindNeighborsInternal(StartingGridAddress, INDEX_NONE, INDEX_NONE, bMustMatchID, RunLength, OutGridAddresses);
+}
+
+void FMatch3Board::FindNeighborsInternal(int32 StartingGridAddress, int32 SwapA, int32 SwapB, bool bMustMatchID, int32 RunLength, TArray<int32>& OutGridAddresses) const
+{
+	if (RunLength < 0)
+	{
+		RunLength = MinimumRunLength;
+	}
+
+	// Handle special, trivial cases.
+	if (RunLength == 0)
+	{
+		return;
+	}
+	else if (RunLength == 1)
+	{
+		OutGridAddresses.Add(StartingGridAddress);
+		return;
+	}
+
+	const int32 FirstNewAddress = OutGridAddresses.Num();
+	const uint8 StartingType = GetSwappedTileType(StartingGridAddress, SwapA, SwapB);
+	const int32 StartX = StartingGridAddress % Width;
+	const int32 StartY = StartingGridAddress / Width;
+
+	// Check verticals, then check horizontals.
+	for (int32 Horizontal = 0; Horizontal < 2; ++Horizontal)
+	{
+		const int32 RunStart = OutGridAddresses.Num();
+		// Check negative direction, then check positive direction.
+		for (int32 Direction = -1; Direction <= 1; Direction += 2)
+		{
+			const int32 MaxGridOffset = !bMustMatchID ? RunLength : (Horizontal ? Width : Height);
+			// Check run length. A run ends when we go off the edge of the map or hit a tile that doesn't match, provided we care about matching.
+			for (int32 GridOffset = 1; GridOffset < MaxGridOffset; ++GridOffset)
+			{
+				const int32 X = StartX + (Horizontal ? (Direction * GridOffset) : 0);
+				const int32 Y = StartY + (Horizontal ? 0 : (Direction * GridOffset));
+				if ((X < 0) || (X >= Width) || (Y < 0) || (Y >= Height))
+				{
+					break;
+				}
+				const int32 NeighborGridAddress = X + (Y * Width);
+				const uint8 NeighborType = GetSwappedTileType(NeighborGridAddress, SwapA, SwapB);
+				if ((NeighborType != EmptyTile) && (!bMustMatchID || (NeighborType == StartingType)))
+				{
+					OutGridAddresses.Add(NeighborGridAddress);
+					continue;
+				}
+				break;
+			}
+		}
+		// See if we have enough to complete a run, or if matching wasn't required. If not, drop what we found on this axis. Note that we add 1 because the starting tile isn't counted yet.
+		if (bMustMatchID && ((OutGridAddresses.Num() - RunStart + 1) < FMath::Min(RunLength, Horizontal ? Width : Height)))
+		{
+			OutGridAddresses.SetNum(RunStart, false);
+		}
+	}
+	// If we found any other tile, or if we're not concerned with matching type, then we have a valid run and need to add the starting tile to the list.
+	if ((OutGridAddresses.Num() > FirstNewAddress) || !bMustMatchID)
+	{
+		OutGridAddresses.Add(StartingGridAddress);
+	}
+}
+
+void FMatch3Board::FindMatches(const TArray<int32>& GridAddressesToCheck, TArray<int32>& OutGridAddresses) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_Match3BoardFindMatches);
+	// Runs found from neighboring addresses overlap, so they are merged in a set rather than searching the output for each address.
+	FMatch3AddressSet MatchingAddressSet;
+	MatchingAddressSet.Init(GetNumSpaces());
+	TArray<int32> MatchingAddresses;
+	for (int32 GridAddress : GridAddressesToCheck)
+	{
+		if (!IsEmpty(GridAddress))
+		{
+			FindNeighbors(GridAddress, MatchingAddresses);
+			MatchingAddressSet.Append(MatchingAddresses);
+		}
+	}
+	MatchingAddressSet.GetGridAddresses(OutGridAddresses);
+}
+
+void FMatch3Board::BuildTypeBitboards(TArray<uint64>& OutBitboards) const
+{
+	OutBitboards.Reset(TypeLibrary.Num() * Height);
+	OutBitboards.AddZeroed(TypeLibrary.Num() * Height);
+	int32 GridAddress = 0;
+	for (int32 Y = 0; Y < Height; ++Y)
+	{
+		for (int32 X = 0; X < Width; ++X, ++GridAddress)
+		{
+			const uint8 TileType = TileTypes[GridAddress];
+			if (TileType != EmptyTile)
+			{
+				OutBitboards[(TileType * Height) + Y] |= (1ULL << X);
+			}
+		}
+	}
+}
+
+bool FMatch3Board::FindAllMatches(FMatch3BoardMask& OutMatches) const
+{
+	check(SupportsBitboards());
+	OutMatches.Init(Height);
+
+	TArray<uint64> Bitboards;
+	BuildTypeBitboards(Bitboards);
+
+	if (MinimumRunLength <= 1)
+	{
+		// Same special cases as FindNeighbors. Every tile is a run by itself, or nothing ever matches.
+		if (MinimumRunLength == 1)
+		{
+			FMemory::Memset(OutMatches.Rows.GetData(), 0xFF, OutMatches.Rows.Num() * sizeof(uint64));
+			for (uint64& Row : OutMatches.Rows)
+			{
+				Row &= (Width < 64) ? ((1ULL << Width) - 1) : ~0ULL;
+			}
+			return true;
+		}
+		return false;
+	}
+
+	// A run can never be longer than the board, so shorter boards score with a full row or column, the same as FindNeighbors.
+	// An axis that is only one tile long can't hold a run at all.
+	const int32 HorizontalRunLength = FMath::Min(MinimumRunLength, Width);
+	const int32 VerticalRunLength = FMath::Min(MinimumRunLength, Height);
+
+	bool bFoundMatch = false;
+	for (int32 TileTypeID = 0; TileTypeID < TypeLibrary.Num(); ++TileTypeID)
+	{
+		const uint64* TypeRows = &Bitboards[TileTypeID * Height];
+
+		// Horizontal runs. After ANDing with each shifted copy, bit X is set only if columns X through X + RunLength - 1 all hold this type.
+		// Shifting the run starts back up by each offset then covers every tile in the run.
+		for (int32 Y = 0; (Y < Height) && (HorizontalRunLength > 1); ++Y)
+		{
+			const uint64 Row = TypeRows[Y];
+			uint64 RunStarts = Row;
+			for (int32 Offset = 1; (Offset < HorizontalRunLength) && RunStarts; ++Offset)
+			{
+				RunStarts &= (Row >> Offset);
+			}
+			if (RunStarts)
+			{
+				uint64 RunTiles = RunStarts;
+				for (int32 Offset = 1; Offset < HorizontalRunLength; ++Offset)
+				{
+					RunTiles |= (RunStarts << Offset);
+				}
+				OutMatches.Rows[Y] |= RunTiles;
+				bFoundMatch = true;
+			}
+		}
+
+		// Vertical runs. The same idea, but whole rows are ANDed together, so every column is tested at once.
+		for (int32 Y = 0; (Y <= (Height - VerticalRunLength)) && (VerticalRunLength > 1); ++Y)
+		{
+			uint64 RunStarts = TypeRows[Y];
+			for (int32 Offset = 1; (Offset < VerticalRunLength) && RunStarts; ++Offset)
+			{
+				RunStarts &= TypeRows[Y + Offset];
+			}
+			if (RunStarts)
+			{
+				for (int32 Offset = 0; Offset < VerticalRunLength; ++Offset)
+				{
+					OutMatches.Rows[Y + Offset] |= RunStarts;
+				}
+				bFoundMatch = true;
+			}
+		}
+	}
+	return bFoundMatch;
+}
+
+bool FMatch3Board::FindCascadeMatches(const TArray<int32>& ChangedGridAddresses, TArray<int32>& OutGridAddresses) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_Match3BoardFindCascadeMatches);
+	OutGridAddresses.Reset();
+	if (SupportsBitboards())
+	{
+		FMatch3BoardMask MatchMask;
+		if (FindAllMatches(MatchMask))
+		{
+			MatchMask.GetGridAddresses(Width, OutGridAddresses);
+		}
+	}
+	else
+	{
+		FindMatches(ChangedGridAddresses, OutGridAddresses);
+	}
+	return (OutGridAddresses.Num() > 0);
+}
+
+void FMatch3Board::FindTilesOfType(int32 TileTypeID, TArray<int32>& OutGridAddresses) const
+{
+	OutGridAddresses.Reset();
+	for (int32 GridAddress = 0; GridAddress < TileTypes.Num(); ++GridAddress)
+	{
+		if (TileTypes[GridAddress] == TileTypeID)
+		{
+			OutGridAddresses.Add(GridAddress);
+		}
+	}
+}
+
+void FMatch3Board::GetExplosionList(int32 GridAddress, int32 AdjustedBombPower, TArray<int32>& OutGridAddresses) const
+{
+	check(CanExplode(GridAddress));
+	FindNeighbors(GridAddress, OutGridAddresses, false, AdjustedBombPower);
+}
+
+bool FMatch3Board::IsMoveLegal(int32 GridAddressA, int32 GridAddressB, TArray<int32>* OutMatch /* = nullptr */) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_Match3BoardIsMoveLegal);
+	if (OutMatch)
+	{
+		OutMatch->Reset();
+	}
+	if ((GridAddressA != GridAddressB) && AreAddressesNeighbors(GridAddressA, GridAddressB) && CanSwap(GridAddressA) && CanSwap(GridAddressB))
+	{
+		if (TileTypes[GridAddressA] != TileTypes[GridAddressB])
+		{
+			// Check for matches at both addresses as if the tiles had been swapped. Nothing on the board actually moves.
+			TArray<int32> LocalMatch;
+			TArray<int32>& Match = OutMatch ? *OutMatch : LocalMatch;
+			FindNeighborsInternal(GridAddressB, GridAddressA, GridAddressB, true, MinimumRunLength, Match);
+			FindNeighborsInternal(GridAddressA, GridAddressA, GridAddressB, true, MinimumRunLength, Match);
+			return (Match.Num() > 0);
+		}
+	}
+	return false;
+}
+
+bool FMatch3Board::IsUnwinnable() const
+{
+	SCOPE_CYCLE_COUNTER(STAT_Match3BoardIsUnwinnable);
+	for (int32 GridAddress = 0; GridAddress < TileTypes.Num(); ++GridAddress)
+	{
+		check(!IsEmpty(GridAddress));
+		// Bombs are always valid.
+		if (CanExplode(GridAddress))
+		{
+			return false;
+		}
+		// A swap is legal in both directions, so checking up and to the right covers every pair of neighbors exactly once.
+		int32 NeighborGridAddress;
+		if (GetGridAddressWithOffset(GridAddress, 0, 1, NeighborGridAddress) && IsMoveLegal(GridAddress, NeighborGridAddress))
+		{
+			return false;
+		}
+		if (GetGridAddressWithOffset(GridAddress, 1, 0, NeighborGridAddress) && IsMoveLegal(GridAddress, NeighborGridAddress))
+		{
+			return false;
+		}
+	}
+	// No powerups or other non-tile moves are available, and no tiles can move in any direction.
+	return true;
+}
+
+void FMatch3Board::CollapseColumns(const TArray<int32>& MatchingGridAddresses, TArray<int32>& OutFallFromGridAddresses, TArray<int32>& OutFallToGridAddresses, TArray<int32>& OutRefillGridAddresses)
+{
+	OutFallFromGridAddresses.Reset();
+	OutFallToGridAddresses.Reset();
+	OutRefillGridAddresses.Reset();
+	for (int32 GridAddress : MatchingGridAddresses)
+	{
+		ClearTile(GridAddress);
+	}
+
+	// Walk each column from the bottom, moving every remaining tile down to the lowest space not yet filled. Whatever is left above that gets refilled.
+	for (int32 X = 0; X < Width; ++X)
+	{
+		int32 NextLandingY = 0;
+		for (int32 Y = 0; Y < Height; ++Y)
+		{
+			const int32 GridAddress = X + (Y * Width);
+			if (IsEmpty(GridAddress))
+			{
+				continue;
+			}
+			if (Y != NextLandingY)
+			{
+				const int32 LandingGridAddress = X + (NextLandingY * Width);
+				SetTile(LandingGridAddress, TileTypes[GridAddress]);
+				ClearTile(GridAddress);
+				OutFallFromGridAddresses.Add(GridAddress);
+				OutFallToGridAddresses.Add(LandingGridAddress);
+			}
+			++NextLandingY;
+		}
+		for (int32 Y = NextLandingY; Y < Height; ++Y)
+		{
+			OutRefillGridAddresses.Add(X + (Y * Width));
+		}
+	}
+}
+
+bool FMatch3Board::Reshuffle(FRandomStream& RandomStream, TArray<int32>& OutSourceGridAddresses)
+{
+	const int32 NumSpaces = GetNumSpaces();
+	const int32 NumTypes = TypeLibrary.Num();
+	const TArray<uint8> OriginalTileTypes = TileTypes;
+	OutSourceGridAddresses.Reset(NumSpaces);
+
+	// The tiles of each type that haven't been placed yet, by where they are now.
+	TArray<TArray<int32>> UnplacedTiles;
+	UnplacedTiles.SetNum(NumTypes);
+	for (int32 GridAddress = 0; GridAddress < NumSpaces; ++GridAddress)
+	{
+		check(!IsEmpty(GridAddress));
+		UnplacedTiles[TileTypes[GridAddress]].Add(GridAddress);
+	}
+
+	// Lay the tiles out again column by column from the bottom-left, as the board is first filled. Each space takes a type that doesn't complete a run with the
+	// tiles to its left or below it, picked in proportion to how many of that type are left. Only if nothing else is left does a space complete a run.
+	OutSourceGridAddresses.AddUninitialized(NumSpaces);
+	for (int32 X = 0; X < Width; ++X)
+	{
+		for (int32 Y = 0; Y < Height; ++Y)
+		{
+			const int32 GridAddress = X + (Y * Width);
+			int32 NumAllowed = 0;
+			int32 NumLeft = 0;
+			for (int32 TileTypeID = 0; TileTypeID < NumTypes; ++TileTypeID)
+			{
+				NumLeft += UnplacedTiles[TileTypeID].Num();
+				if (UnplacedTiles[TileTypeID].Num() && !WouldCompleteRun(GridAddress, TileTypeID))
+				{
+					NumAllowed += UnplacedTiles[TileTypeID].Num();
+				}
+			}
+			const bool bAnyAllowed = (NumAllowed > 0);
+			int32 Pick = RandomStream.RandRange(0, (bAnyAllowed ? NumAllowed : NumLeft) - 1);
+			int32 TileTypeID = 0;
+			for (; TileTypeID < NumTypes; ++TileTypeID)
+			{
+				if (UnplacedTiles[TileTypeID].Num() && (!bAnyAllowed || !WouldCompleteRun(GridAddress, TileTypeID)))
+				{
+					Pick -= UnplacedTiles[TileTypeID].Num();
+					if (Pick < 0)
+					{
+						break;
+					}
+				}
+			}
+			OutSourceGridAddresses[GridAddress] = UnplacedTiles[TileTypeID].Pop(false);
+			SetTile(GridAddress, TileTypeID);
+		}
+	}
+
+	auto SwapSpaces = [this, &OutSourceGridAddresses](int32 GridAddressA, int32 GridAddressB)
+	{
+		SwapTiles(GridAddressA, GridAddressB);
+		Swap(OutSourceGridAddresses[GridAddressA], OutSourceGridAddresses[GridAddressB]);
+	};
+	TArray<int32> Matches;
+	TArray<int32> ChangedAddresses;
+
+	// Where the tiles of each type are, so swap partners and donors of a type are found without scanning the board. Every swap that is kept updates them.
+	TArray<TArray<int32>> TypeAddresses;
+	TypeAddresses.SetNum(NumTypes);
+	TArray<int32> TypeAddressIndices;
+	TypeAddressIndices.SetNumUninitialized(NumSpaces);
+	for (int32 GridAddress = 0; GridAddress < NumSpaces; ++GridAddress)
+	{
+		TypeAddressIndices[GridAddress] = TypeAddresses[TileTypes[GridAddress]].Add(GridAddress);
+	}
+	auto KeepSwap = [this, &TypeAddresses, &TypeAddressIndices](int32 GridAddressA, int32 GridAddressB)
+	{
+		// Each space now holds the type the other one was listed under, so each takes over the other's entry.
+		const int32 IndexA = TypeAddressIndices[GridAddressA];
+		const int32 IndexB = TypeAddressIndices[GridAddressB];
+		TypeAddresses[TileTypes[GridAddressA]][IndexB] = GridAddressA;
+		TypeAddresses[TileTypes[GridAddressB]][IndexA] = GridAddressB;
+		TypeAddressIndices[GridAddressA] = IndexB;
+		TypeAddressIndices[GridAddressB] = IndexA;
+	};
+
+	// Break up any run that had to be made, by swapping one of its tiles with a tile elsewhere that leaves neither space in a run.
+	TArray<int32> AllAddresses;
+	AllAddresses.Reserve(NumSpaces);
+	for (int32 GridAddress = 0; GridAddress < NumSpaces; ++GridAddress)
+	{
+		AllAddresses.Add(GridAddress);
+	}
+	TArray<int32> RunAddresses;
+	TArray<int32> NearbyPartners;
+	const FIntPoint Directions[] = { FIntPoint(1, 0), FIntPoint(-1, 0), FIntPoint(0, 1), FIntPoint(0, -1) };
+	FindCascadeMatches(AllAddresses, RunAddresses);
+	for (int32 RunAddress : RunAddresses)
+	{
+		FindNeighbors(RunAddress, Matches);
+		if (Matches.Num() == 0)
+		{
+			// An earlier swap already broke this run.
+			continue;
+		}
+		// Try partners one type at a time, starting from a random type and a random tile of it.
+		const uint8 RunTileTypeID = TileTypes[RunAddress];
+		const int32 FirstOtherType = RandomStream.RandRange(0, NumTypes - 1);
+		bool bBroken = false;
+		for (int32 TypeIndex = 0; (TypeIndex < NumTypes) && !bBroken; ++TypeIndex)
+		{
+			const int32 OtherTileTypeID = (FirstOtherType + TypeIndex) % NumTypes;
+			const TArray<int32>& Partners = TypeAddresses[OtherTileTypeID];
+			if ((OtherTileTypeID == RunTileTypeID) || (Partners.Num() == 0))
+			{
+				continue;
+			}
+
+			// If a tile of this type would complete a run in the run's space, only a partner from that run's row or column can break it up.
+			NearbyPartners.Reset();
+			SetTile(RunAddress, OtherTileTypeID);
+			FindNeighbors(RunAddress, Matches);
+			SetTile(RunAddress, RunTileTypeID);
+			const bool bOnlyNearby = (Matches.Num() > 0);
+			if (bOnlyNearby)
+			{
+				for (const FIntPoint& Direction : Directions)
+				{
+					for (int32 Distance = 1; Distance < MinimumRunLength; ++Distance)
+					{
+						int32 NearbyAddress;
+						if (GetGridAddressWithOffset(RunAddress, Direction.X * Distance, Direction.Y * Distance, NearbyAddress) && (TileTypes[NearbyAddress] == OtherTileTypeID))
+						{
+							NearbyPartners.Add(NearbyAddress);
+						}
+					}
+				}
+			}
+			const TArray<int32>& Candidates = bOnlyNearby ? NearbyPartners : Partners;
+			const int32 FirstCandidate = (Candidates.Num() > 0) ? RandomStream.RandRange(0, Candidates.Num() - 1) : 0;
+			for (int32 CandidateIndex = 0; CandidateIndex < Candidates.Num(); ++CandidateIndex)
+			{
+				const int32 OtherAddress = Candidates[(FirstCandidate + CandidateIndex) % Candidates.Num()];
+				SwapSpaces(RunAddress, OtherAddress);
+				ChangedAddresses.Reset();
+				ChangedAddresses.Add(RunAddress);
+				ChangedAddresses.Add(OtherAddress);
+				FindMatches(ChangedAddresses, Matches);
+				if (Matches.Num() == 0)
+				{
+					KeepSwap(RunAddress, OtherAddress);
+					bBroken = true;
+					break;
+				}
+				SwapSpaces(RunAddress, OtherAddress);
+			}
+		}
+	}
+
+	// Make sure there is a move to play. A run of one type is set up one swap away from completing, using tiles of that type from elsewhere on the board.
+	if (IsUnwinnable())
+	{
+		const int32 RunLength = FMath::Max(MinimumRunLength, 2);
+		const FIntPoint Axes[] = { FIntPoint(1, 0), FIntPoint(0, 1) };
+		TArray<int32> PatternAddresses;
+		FMatch3AddressSet PatternAddressSet;
+		PatternAddressSet.Init(NumSpaces);
+		TArray<int32> SwappedPairs;
+		const int32 FirstAddress = RandomStream.RandRange(0, NumSpaces - 1);
+		bool bPlacedMove = false;
+		for (int32 AddressIndex = 0; (AddressIndex < NumSpaces) && !bPlacedMove; ++AddressIndex)
+		{
+			const int32 OriginAddress = (FirstAddress + AddressIndex) % NumSpaces;
+			const FIntPoint Origin(OriginAddress % Width, OriginAddress / Width);
+			const uint8 TileTypeID = TileTypes[OriginAddress];
+			if (!TypeLibrary[TileTypeID].CanSwap())
+			{
+				continue;
+			}
+			for (int32 PatternIndex = 0; (PatternIndex < 4) && !bPlacedMove; ++PatternIndex)
+			{
+				// The mover either sits beside the space that would finish the run, or just past it along the run.
+				const FIntPoint Axis = Axes[PatternIndex / 2];
+				const FIntPoint MoverOffset = (PatternIndex & 1) ? Axis : FIntPoint(Axis.Y, Axis.X);
+				const FIntPoint Target = Origin + (Axis * (RunLength - 1));
+				const FIntPoint Mover = Target + MoverOffset;
+				if ((Mover.X >= Width) || (Mover.Y >= Height) || (Target.X >= Width) || (Target.Y >= Height))
+				{
+					continue;
+				}
+				const int32 TargetAddress = Target.X + (Target.Y * Width);
+				const int32 MoverAddress = Mover.X + (Mover.Y * Width);
+				if ((TileTypes[TargetAddress] == TileTypeID) || !CanSwap(TargetAddress))
+				{
+					continue;
+				}
+
+				// Bring a tile of the run's type into each space of the pattern that doesn't have one.
+				PatternAddresses.Reset();
+				for (int32 RunIndex = 0; RunIndex < (RunLength - 1); ++RunIndex)
+				{
+					const FIntPoint Space = Origin + (Axis * RunIndex);
+					PatternAddresses.Add(Space.X + (Space.Y * Width));
+				}
+				PatternAddresses.Add(MoverAddress);
+				PatternAddresses.Add(TargetAddress);
+				PatternAddressSet.Append(PatternAddresses);
+				SwappedPairs.Reset();
+
+				// The type's tiles are only listed where they were before this attempt. Each donor used is passed by the cursor, and tiles moved into the
+				// pattern are skipped along with the ones already there, so every donor still holds the type when it is reached.
+				const TArray<int32>& Donors = TypeAddresses[TileTypeID];
+				int32 DonorCursor = 0;
+				bool bFoundTiles = true;
+				for (int32 PatternIndexToFill = 1; (PatternIndexToFill < (PatternAddresses.Num() - 1)) && bFoundTiles; ++PatternIndexToFill)
+				{
+					const int32 SpaceAddress = PatternAddresses[PatternIndexToFill];
+					if (TileTypes[SpaceAddress] == TileTypeID)
+					{
+						continue;
+					}
+					bFoundTiles = false;
+					while (DonorCursor < Donors.Num())
+					{
+						const int32 DonorAddress = Donors[DonorCursor++];
+						if (!PatternAddressSet.Contains(DonorAddress))
+						{
+							SwapSpaces(SpaceAddress, DonorAddress);
+							SwappedPairs.Add(SpaceAddress);
+							SwappedPairs.Add(DonorAddress);
+							bFoundTiles = true;
+							break;
+						}
+					}
+				}
+				for (int32 PatternAddress : PatternAddresses)
+				{
+					PatternAddressSet.Remove(PatternAddress);
+				}
+				if (bFoundTiles)
+				{
+					FindMatches(SwappedPairs, Matches);
+					bPlacedMove = (Matches.Num() == 0) && IsMoveLegal(MoverAddress, TargetAddress);
+				}
+				if (!bPlacedMove)
+				{
+					for (int32 PairIndex = SwappedPairs.Num() - 2; PairIndex >= 0; PairIndex -= 2)
+					{
+						SwapSpaces(SwappedPairs[PairIndex], SwappedPairs[PairIndex + 1]);
+					}
+				}
+			}
+		}
+	}
+
+	// Give up and leave the board as it was if the tiles can't be arranged into a playable board, such as when too few tiles can be swapped.
+	FindCascadeMatches(AllAddresses, Matches);
+	if ((Matches.Num() > 0) || IsUnwinnable())
+	{
+		for (int32 GridAddress = 0; GridAddress < NumSpaces; ++GridAddress)
+		{
+			SetTile(GridAddress, OriginalTileTypes[GridAddress]);
+			OutSourceGridAddresses[GridAddress] = GridAddress;
+		}
+		return false;
+	}
+	return true;
+}
+
+uint32 FMatch3Board::GetChecksum() const
+{
+	return FCrc::MemCrc32(TileTypes.GetData(), TileTypes.Num() * TileTypes.GetTypeSize());
+}
@@ -0,0 +1,220 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Tile.h"
+
+/** The parts of a tile type that the rules care about. Built from the grid's tile library. */
+struct FMatch3BoardTileType
+{
+	/** Relative likelihood of this type being selected when filling the board. */
+	float Probability;
+
+	/** Power rating of a bomb of this type. */
+	int32 BombPower;
+
+	/** Tile explodes when selected. */
+	uint8 bExplodes : 1;
+
+	/** Tile can't be selected as part of a normal swapping move. */
+	uint8 bPreventSwapping : 1;
+
+	FMatch3BoardTileType()
+		: Probability(1.0f)
+		, BombPower(0)
+		, bExplodes(false)
+		, bPreventSwapping(false)
+	{
+	}
+
+	bool CanExplode() const { return bExplodes; }
+	bool CanSwap() const { return (!bPreventSwapping && !bExplodes); }
+};
+
+/** One bit per grid space, stored one row per 64-bit word with bit X holding column X. */
+struct MATCH3_API FMatch3BoardMask
+{
+	TArray<uint64> Rows;
+
+	/** Clear the mask and size it for a board with the given number of rows. */
+	void Init(int32 Height);
+	bool IsSet(int32 X, int32 Y) const { return ((Rows[Y] >> X) & 1) != 0; }
+	/** True if no bits are set. */
+	bool IsEmpty() const;
+	/** Number of bits set. */
+	int32 Num() const;
+	/** List the grid addresses of every set bit, in address order. */
+	void GetGridAddresses(int32 Width, TArray<int32>& OutGridAddresses) const;
+};
+
+/** A set of grid addresses, stored as one bit per space so that adding, removing and testing an address take constant time. */
+struct MATCH3_API FMatch3AddressSet
+{
+	FMatch3AddressSet();
+
+	/** Empty the set and size it for a board with the given number of spaces. */
+	void Init(int32 NumSpaces);
+	/** Remove every address, keeping the size. */
+	void Reset();
+
+	/** Add an address. Returns true if it wasn't already in the set. */
+	bool Add(int32 GridAddress);
+	/** Add every address in the list. */
+	void Append(const TArray<int32>& GridAddresses);
+	/** Remove an address. Returns true if it was in the set. */
+	bool Remove(int32 GridAddress);
+	bool Contains(int32 GridAddress) const { return ((Words[GridAddress >> 6] >> (GridAddress & 63)) & 1) != 0; }
+
+	/** Add every address in another set of the same size. */
+	void Union(const FMatch3AddressSet& Other);
+	/** Keep only the addresses that are also in another set of the same size. */
+	void Intersect(const FMatch3AddressSet& Other);
+
+	int32 Num() const { return Count; }
+	bool IsEmpty() const { return (Count == 0); }
+	/** List every address in the set, in address order. */
+	void GetGridAddresses(TArray<int32>& OutGridAddresses) const;
+
+private:
+	/** Recount the set bits after a whole-set operation. */
+	void UpdateCount();
+
+	TArray<uint64> Words;
+	int32 Count;
+};
+
+/**
+ * Plain-data match-3 board. Stores one type ID and one state per grid address and owns the game rules, so they can be run without a world or any tile actors.
+ * Grid addresses match AGrid: address 0 is the bottom-left space, X increases to the right and Y increases upward.
+ */
+struct MATCH3_API FMatch3Board
+{
+	/** Type value stored in spaces that don't currently hold a tile. */
+	static const uint8 EmptyTile = 0xFF;
+
+	/** Widest board that bitboard operations support, since each row is held in one 64-bit word. */
+	static const int32 MaxBitboardWidth = 64;
+
+	FMatch3Board();
+
+	/** Resize the board and clear every space. */
+	void Init(int32 InWidth, int32 InHeight, int32 InMinimumRunLength);
+
+	/** Set the list of tile types that type IDs on this board refer to. */
+	void SetTileTypes(const TArray<FMatch3BoardTileType>& InTileTypes);
+
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+	int32 GetNumSpaces() const { return TileTypes.Num(); }
+	int32 GetMinimumRunLength() const { return MinimumRunLength; }
+	const TArray<FMatch3BoardTileType>& GetTileTypes() const { return TypeLibrary; }
+
+	bool IsValidAddress(int32 GridAddress) const { return TileTypes.IsValidIndex(GridAddress); }
+	/** Get a grid address relative to another grid address. Offset between addresses is measured in tiles. */
+	bool GetGridAddressWithOffset(int32 InitialGridAddress, int32 XOffset, int32 YOffset, int32& ReturnGridAddress) const;
+	/** Determine if two grid addresses are valid and adjacent. */
+	bool AreAddressesNeighbors(int32 GridAddressA, int32 GridAddressB) const;
+
+	/** Type ID of the tile at the given address, or INDEX_NONE if the space is empty. */
+	int32 GetTileType(int32 GridAddress) const;
+	bool IsEmpty(int32 GridAddress) const { return (TileTypes[GridAddress] == EmptyTile); }
+	ETileState::Type GetTileState(int32 GridAddress) const { return (ETileState::Type)TileStates[GridAddress]; }
+	void SetTileState(int32 GridAddress, ETileState::Type NewState) { TileStates[GridAddress] = (uint8)NewState; }
+	bool CanExplode(int32 GridAddress) const;
+	bool CanSwap(int32 GridAddress) const;
+
+	/** Place a tile of the given type in a space, replacing whatever was there. */
+	void SetTile(int32 GridAddress, int32 TileTypeID, ETileState::Type NewState = ETileState::ETS_Normal);
+	/** Remove the tile from a space. */
+	void ClearTile(int32 GridAddress);
+	/** Exchange the contents of two spaces. */
+	void SwapTiles(int32 GridAddressA, int32 GridAddressB);
+
+	/** True if any space has changed since the last call to ClearDirtyRegion. */
+	bool IsDirty() const { return bDirty; }
+	/** Get the lowest and highest rows changed in a column since the last call to ClearDirtyRegion. Returns false if nothing in the column changed. */
+	bool GetDirtyRows(int32 X, int32& OutMinY, int32& OutMaxY) const;
+	/** Mark every space as changed. */
+	void MarkAllDirty();
+	/** Forget which spaces have changed. */
+	void ClearDirtyRegion();
+
+	/** True if placing TileTypeID at GridAddress would complete a run with the tiles to its left or below it. Used when filling the board from the bottom-left. */
+	bool WouldCompleteRun(int32 GridAddress, int32 TileTypeID) const;
+
+	/** Check for a successful sequence. bMustMatchID can be set to false to ignore matching. RunLength will default to MinimumRunLength if negative. */
+	void FindNeighbors(int32 StartingGridAddress, TArray<int32>& OutGridAddresses, bool bMustMatchID = true, int32 RunLength = -1) const;
+	/** Union of FindNeighbors for every address in the list. */
+	void FindMatches(const TArray<int32>& GridAddressesToCheck, TArray<int32>& OutGridAddresses) const;
+	/** True if FindAllMatches can be used on a board of this size. */
+	bool SupportsBitboards() const { return (Width <= MaxBitboardWidth); }
+	/** Find every space on the board that is part of a scoring run, using one bitboard per tile type. Returns true if any match was found. */
+	bool FindAllMatches(FMatch3BoardMask& OutMatches) const;
+	/** Find every run that a cascade has completed, using bitboards when the board supports them and otherwise checking only ChangedGridAddresses. Any new run must include a changed space, since the board had none before. Returns true if any match was found. */
+	bool FindCascadeMatches(const TArray<int32>& ChangedGridAddresses, TArray<int32>& OutGridAddresses) const;
+	/** Find all tiles of a given type. */
+	void FindTilesOfType(int32 TileTypeID, TArray<int32>& OutGridAddresses) const;
+	/** Get the list of spaces that will be affected by a bomb's explosion at the given power. */
+	void GetExplosionList(int32 GridAddress, int32 AdjustedBombPower, TArray<int32>& OutGridAddresses) const;
+
+	/** Tests a move to see if it's permitted, without changing the board. If OutMatch is provided, it receives the matching addresses as they will be once the swap has been made. */
+	bool IsMoveLegal(int32 GridAddressA, int32 GridAddressB, TArray<int32>* OutMatch = nullptr) const;
+	/** Detects unwinnable states. */
+	bool IsUnwinnable() const;
+
+	/**
+	 * Remove the matched tiles and let every tile above them fall, in one pass over the board.
+	 * Each tile that moves is listed in OutFallFromGridAddresses, with the space it lands in at the same index of OutFallToGridAddresses.
+	 * OutRefillGridAddresses receives the empty spaces left at the top of each column: columns from left to right, and the lowest space in each column first.
+	 */
+	void CollapseColumns(const TArray<int32>& MatchingGridAddresses, TArray<int32>& OutFallFromGridAddresses, TArray<int32>& OutFallToGridAddresses, TArray<int32>& OutRefillGridAddresses);
+
+	/**
+	 * Move the tiles on a full board into a new random layout that has no runs and at least one legal move, without adding or removing any tiles.
+	 * OutSourceGridAddresses receives, for each space, the address its tile was moved from. Takes time bounded by the board size.
+	 * Returns false and leaves the board unchanged if no such layout was found, which can happen when there are too few tiles that can be swapped.
+	 */
+	bool Reshuffle(FRandomStream& RandomStream, TArray<int32>& OutSourceGridAddresses);
+
+	/** Checksum of the tile type in every space, for checking that two boards match. */
+	uint32 GetChecksum() const;
+
+private:
+	/** Type at an address as if the tiles at SwapA and SwapB had been exchanged. Pass INDEX_NONE for both to read the board as it is. */
+	FORCEINLINE uint8 GetSwappedTileType(int32 GridAddress, int32 SwapA, int32 SwapB) const
+	{
+		return TileTypes[(GridAddress == SwapA) ? SwapB : ((GridAddress == SwapB) ? SwapA : GridAddress)];
+	}
+
+	/** Fill one row mask per tile type per row, indexed by (TileTypeID * Height) + Y. */
+	void BuildTypeBitboards(TArray<uint64>& OutBitboards) const;
+
+	/** Record that the contents of a space have changed. */
+	FORCEINLINE void MarkDirty(int32 GridAddress)
+	{
+		const int32 X = GridAddress % Width;
+		const int32 Y = GridAddress / Width;
+		DirtyMinY[X] = FMath::Min(DirtyMinY[X], Y);
+		DirtyMaxY[X] = FMath::Max(DirtyMaxY[X], Y);
+		bDirty = true;
+	}
+
+	void FindNeighborsInternal(int32 StartingGridAddress, int32 SwapA, int32 SwapB, bool bMustMatchID, int32 RunLength, TArray<int32>& OutGridAddresses) const;
+
+	int32 Width;
+	int32 Height;
+	int32 MinimumRunLength;
+
+	/** Type ID for each space, or EmptyTile. */
+	TArray<uint8> TileTypes;
+	/** ETileState for each space. */
+	TArray<uint8> TileStates;
+	/** Rule data for each tile type. */
+	TArray<FMatch3BoardTileType> TypeLibrary;
+
+	/** Lowest and highest changed row in each column. A column is clean when its minimum is above its maximum. */
+	TArray<int32> DirtyMinY;
+	TArray<int32> DirtyMaxY;
+	/** True if any column has changed. */
+	bool bDirty;
+};
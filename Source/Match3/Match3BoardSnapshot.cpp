@@ -0,0 +1,115 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "Match3.h"
+#include "Match3BoardSnapshot.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+
+FMatch3BoardSnapshot::FMatch3BoardSnapshot()
+	: LevelID(0)
+	, Width(0)
+	, Height(0)
+	, NumTileTypes(0)
+	, RandomSeed(0)
+	, TimeRemaining(0.0f)
+	, Score(0)
+	, ComboPower(0)
+{
+}
+
+void FMatch3BoardSnapshot::Encode(TArray<uint8>& OutBytes) const
+{
+	FBitWriter Writer(0, true);
+	uint32 Magic = FileMagic;
+	uint32 Version = FileVersion;
+	uint32 LevelIDValue = LevelID;
+	// A snapshot without a board is saved as a zero-size one.
+	uint16 WidthValue = IsValid() ? (uint16)Width : 0;
+	uint16 HeightValue = IsValid() ? (uint16)Height : 0;
+	uint8 NumTileTypesValue = (uint8)NumTileTypes;
+	int32 RandomSeedValue = RandomSeed;
+	float TimeRemainingValue = TimeRemaining;
+	int32 ScoreValue = Score;
+	int32 ComboPowerValue = ComboPower;
+	Writer << Magic;
+	Writer << Version;
+	Writer << LevelIDValue;
+	Writer << WidthValue;
+	Writer << HeightValue;
+	Writer << NumTileTypesValue;
+	Writer << RandomSeedValue;
+	Writer << TimeRemainingValue;
+	Writer << ScoreValue;
+	Writer << ComboPowerValue;
+	if (IsValid())
+	{
+		const int32 BitsPerTile = GetBitsPerTile(NumTileTypes);
+		for (uint8 TileTypeID : TileTypes)
+		{
+			Writer.SerializeBits(&TileTypeID, BitsPerTile);
+		}
+	}
+
+	OutBytes = *Writer.GetBuffer();
+	OutBytes.SetNum(Writer.GetNumBytes());
+}
+
+bool FMatch3BoardSnapshot::Decode(const TArray<uint8>& Bytes)
+{
+	*this = FMatch3BoardSnapshot();
+	FBitReader Reader(const_cast<uint8*>(Bytes.GetData()), Bytes.Num() * 8);
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	uint16 WidthValue = 0;
+	uint16 HeightValue = 0;
+	uint8 NumTileTypesValue = 0;
+	Reader << Magic;
+	Reader << Version;
+	if (Reader.IsError() || (Magic != FileMagic) || (Version != FileVersion))
+	{
+		return false;
+	}
+	Reader << LevelID;
+	Reader << WidthValue;
+	Reader << HeightValue;
+	Reader << NumTileTypesValue;
+	Reader << RandomSeed;
+	Reader << TimeRemaining;
+	Reader << Score;
+	Reader << ComboPower;
+	Width = WidthValue;
+	Height = HeightValue;
+	NumTileTypes = NumTileTypesValue;
+	if (Reader.IsError())
+	{
+		*this = FMatch3BoardSnapshot();
+		return false;
+	}
+	if ((Width > 0) && (Height > 0))
+	{
+		// Check the size against the data that is actually there before allocating anything, so a damaged file can't ask for a huge board.
+		const int32 BitsPerTile = GetBitsPerTile(NumTileTypes);
+		if ((NumTileTypes <= 0) || (Width > MaxSize) || (Height > MaxSize) || ((int64)Width * Height * BitsPerTile > Reader.GetBitsLeft()))
+		{
+			*this = FMatch3BoardSnapshot();
+			return false;
+		}
+		TileTypes.SetNumUninitialized(Width * Height);
+		for (uint8& TileTypeID : TileTypes)
+		{
+			TileTypeID = 0;
+			Reader.SerializeBits(&TileTypeID, BitsPerTile);
+			if (TileTypeID >= NumTileTypes)
+			{
+				*this = FMatch3BoardSnapshot();
+				return false;
+			}
+		}
+	}
+	if (Reader.IsError())
+	{
+		*this = FMatch3BoardSnapshot();
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,46 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+/**
+ * Everything needed to carry on a game from a settled board: the tile types, the random stream, the time left, the score and the combo power.
+ * Tile types are bit-packed, so a snapshot of the shipping board takes under a hundred bytes and can be written after every move.
+ */
+struct MATCH3_API FMatch3BoardSnapshot
+{
+	/** File identifier and format version. Bump the version when the layout changes. */
+	static const uint32 FileMagic = 0x5342334D;
+	static const uint32 FileVersion = 2;
+
+	/** Widest or tallest board a snapshot can hold. Larger sizes in a loaded file are treated as damage. */
+	static const int32 MaxSize = 1024;
+
+	/** ID of the level the game was played in, from FMatch3LevelRecordStore::GetLevelID. */
+	uint32 LevelID;
+	int32 Width;
+	int32 Height;
+	/** Number of types in the grid's tile library. Each tile is stored in GetBitsPerTile(NumTileTypes) bits. */
+	int32 NumTileTypes;
+	/** Type ID in each space, in grid address order. */
+	TArray<uint8> TileTypes;
+	/** Current seed of the grid's random stream, so restored games keep picking the same tiles they would have. */
+	int32 RandomSeed;
+	float TimeRemaining;
+	int32 Score;
+	int32 ComboPower;
+
+	FMatch3BoardSnapshot();
+
+	/** True if the snapshot holds a board. A default snapshot, saved when no game is in progress, doesn't. */
+	bool IsValid() const { return (Width > 0) && (Height > 0) && (TileTypes.Num() == Width * Height); }
+
+	void Encode(TArray<uint8>& OutBytes) const;
+	/** Read an encoded snapshot. Returns false, leaving an invalid snapshot, if the data is not a snapshot or has an unknown version. */
+	bool Decode(const TArray<uint8>& Bytes);
+
+	/** Bits needed to store any type ID below NumTileTypes. */
+	static int32 GetBitsPerTile(int32 NumTileTypes) { return FMath::Max<int32>(1, FMath::CeilLogTwo((uint32)NumTileTypes)); }
+
+	/** Save slot that holds the snapshot for a save slot. */
+	static FString GetSlotName(const FString& SaveSlotName) { return SaveSlotName + TEXT("_Board"); }
+};
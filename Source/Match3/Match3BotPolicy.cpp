@@ -0,0 +1,145 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "Match3.h"
+#include "Match3BotPolicy.h"
+
+void FMatch3BotPolicy::PlayMove(FMatch3HeadlessGame& Game, const FMatch3BotMove& Move, int32 BombPowerBonus)
+{
+	Game.SelectTile(Move.GridAddressA, BombPowerBonus);
+	if (Move.GridAddressB != INDEX_NONE)
+	{
+		Game.SelectTile(Move.GridAddressB);
+	}
+}
+
+/** Picks uniformly among every legal swap and bomb. */
+class FMatch3RandomBotPolicy : public FMatch3BotPolicy
+{
+public:
+	virtual const TCHAR* GetName() const override { return TEXT("Random"); }
+
+	virtual bool ChooseMove(const FMatch3HeadlessGame& Game, FRandomStream& RandomStream, FMatch3BotMove& OutMove) override
+	{
+		const FMatch3MoveIndex& MoveIndex = Game.GetMoveIndex();
+		const int32 NumSwaps = MoveIndex.GetNumLegalSwaps();
+		const int32 NumBombs = MoveIndex.GetNumBombs();
+		if ((NumSwaps + NumBombs) == 0)
+		{
+			return false;
+		}
+		int32 MoveNumber = RandomStream.RandRange(0, NumSwaps + NumBombs - 1);
+		if (MoveNumber < NumSwaps)
+		{
+			MoveIndex.GetLegalSwap(MoveNumber, OutMove.GridAddressA, OutMove.GridAddressB);
+			return true;
+		}
+
+		// Find the chosen bomb.
+		MoveNumber -= NumSwaps;
+		for (int32 GridAddress = 0; GridAddress < Game.GetBoard().GetNumSpaces(); ++GridAddress)
+		{
+			if (MoveIndex.IsBomb(GridAddress) && (MoveNumber-- == 0))
+			{
+				OutMove.GridAddressA = GridAddress;
+				OutMove.GridAddressB = INDEX_NONE;
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+/** Always plays the first move in the move index. Costs almost nothing, so benchmarks measure the game rather than the bot. */
+class FMatch3FirstBotPolicy : public FMatch3BotPolicy
+{
+public:
+	virtual const TCHAR* GetName() const override { return TEXT("First"); }
+
+	virtual bool ChooseMove(const FMatch3HeadlessGame& Game, FRandomStream& RandomStream, FMatch3BotMove& OutMove) override
+	{
+		const FMatch3MoveIndex& MoveIndex = Game.GetMoveIndex();
+		if (MoveIndex.GetNumLegalSwaps() > 0)
+		{
+			MoveIndex.GetLegalSwap(0, OutMove.GridAddressA, OutMove.GridAddressB);
+			return true;
+		}
+		for (int32 GridAddress = 0; GridAddress < Game.GetBoard().GetNumSpaces(); ++GridAddress)
+		{
+			if (MoveIndex.IsBomb(GridAddress))
+			{
+				OutMove.GridAddressA = GridAddress;
+				OutMove.GridAddressB = INDEX_NONE;
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+/** Plays the swap that clears the most tiles right away, ignoring cascades. Bombs are only used when no swap is available. Ties are broken at random. */
+class FMatch3GreedyBotPolicy : public FMatch3BotPolicy
+{
+public:
+	virtual const TCHAR* GetName() const override { return TEXT("Greedy"); }
+
+	virtual bool ChooseMove(const FMatch3HeadlessGame& Game, FRandomStream& RandomStream, FMatch3BotMove& OutMove) override
+	{
+		const FMatch3Board& Board = Game.GetBoard();
+		const FMatch3MoveIndex& MoveIndex = Game.GetMoveIndex();
+		int32 BestNumTiles = 0;
+		int32 NumTies = 0;
+		for (int32 SwapIndex = 0; SwapIndex < MoveIndex.GetNumLegalSwaps(); ++SwapIndex)
+		{
+			int32 GridAddressA, GridAddressB;
+			MoveIndex.GetLegalSwap(SwapIndex, GridAddressA, GridAddressB);
+			Board.IsMoveLegal(GridAddressA, GridAddressB, &MatchScratch);
+			const int32 NumTiles = MatchScratch.Num();
+			if (NumTiles > BestNumTiles)
+			{
+				BestNumTiles = NumTiles;
+				NumTies = 1;
+			}
+			else if (NumTiles == BestNumTiles)
+			{
+				// Reservoir sampling keeps each tied swap equally likely.
+				++NumTies;
+				if (RandomStream.RandRange(0, NumTies - 1) != 0)
+				{
+					continue;
+				}
+			}
+			else
+			{
+				continue;
+			}
+			OutMove.GridAddressA = GridAddressA;
+			OutMove.GridAddressB = GridAddressB;
+		}
+		if (BestNumTiles > 0)
+		{
+			return true;
+		}
+		return FirstPolicy.ChooseMove(Game, RandomStream, OutMove);
+	}
+
+private:
+	TArray<int32> MatchScratch;
+	FMatch3FirstBotPolicy FirstPolicy;
+};
+
+TSharedPtr<FMatch3BotPolicy> FMatch3BotPolicy::Create(const FString& Name)
+{
+	if (Name == TEXT("Random"))
+	{
+		return MakeShareable(new FMatch3RandomBotPolicy());
+	}
+	if (Name == TEXT("First"))
+	{
+		return MakeShareable(new FMatch3FirstBotPolicy());
+	}
+	if (Name == TEXT("Greedy"))
+	{
+		return MakeShareable(new FMatch3GreedyBotPolicy());
+	}
+	return nullptr;
+}
@@ -0,0 +1,37 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Match3HeadlessGame.h"
+
+/** A move chosen by a bot: a swap between two neighbors, or a bomb detonation if GridAddressB is INDEX_NONE. */
+struct FMatch3BotMove
+{
+	int32 GridAddressA;
+	int32 GridAddressB;
+
+	FMatch3BotMove()
+		: GridAddressA(INDEX_NONE)
+		, GridAddressB(INDEX_NONE)
+	{
+	}
+};
+
+/** Chooses moves for automated play of an FMatch3HeadlessGame. */
+class MATCH3_API FMatch3BotPolicy
+{
+public:
+	virtual ~FMatch3BotPolicy() {}
+
+	/** Name used to pick this policy on the command line. */
+	virtual const TCHAR* GetName() const = 0;
+
+	/** Pick one of the game's available moves. Returns false if there is nothing to do. */
+	virtual bool ChooseMove(const FMatch3HeadlessGame& Game, FRandomStream& RandomStream, FMatch3BotMove& OutMove) = 0;
+
+	/** Play a chosen move on the game, as a player would by selecting its tiles. */
+	static void PlayMove(FMatch3HeadlessGame& Game, const FMatch3BotMove& Move, int32 BombPowerBonus = 0);
+
+	/** Create a policy by name: "Random", "First" or "Greedy". Returns null for unknown names. */
+	static TSharedPtr<FMatch3BotPolicy> Create(const FString& Name);
+};
@@ -0,0 +1,121 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "Match3.h"
+#include "Match3CascadeResolver.h"
+#include "Match3HeadlessGame.h"
+
+DECLARE_CYCLE_STAT(TEXT("Resolve Cascade"), STAT_Match3ResolveCascade, STATGROUP_Match3);
+DECLARE_CYCLE_STAT(TEXT("Cascade Step"), STAT_Match3CascadeStep, STATGROUP_Match3);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cascade Steps Resolved"), STAT_Match3CascadeStepsResolved, STATGROUP_Match3);
+
+FMatch3CascadeScript::FMatch3CascadeScript()
+{
+	Reset();
+}
+
+void FMatch3CascadeScript::Reset()
+{
+	Steps.Reset();
+	Score = 0;
+	ComboPower = 0;
+	NumMatches = 0;
+	NumTilesSpawned = 0;
+}
+
+void FMatch3CascadeResolver::Resolve(FMatch3Board& Board, const FMatch3TileSampler& TileSampler, FRandomStream& RandomStream, const FMatch3GameSettings& Settings,
+	const TArray<int32>& MatchingGridAddresses, EMatch3MoveType::Type MoveType, int32 ComboPower,
+	FMatch3CascadeScript& OutScript, bool bRecordSteps, FMatch3GamePhaseTimes* PhaseTimes)
+{
+	// Each cascade, and each step inside it, shows up as its own scope in "stat Match3" and, with "stat namedevents", in external profilers.
+	SCOPE_CYCLE_COUNTER(STAT_Match3ResolveCascade);
+	OutScript.Reset();
+	OutScript.ComboPower = ComboPower;
+
+	// Clock reads are skipped entirely unless phase times were asked for.
+	double PhaseStartTime = PhaseTimes ? FPlatformTime::Seconds() : 0.0;
+	auto EndPhase = [PhaseTimes, &PhaseStartTime](double FMatch3GamePhaseTimes::* PhaseTime)
+	{
+		if (PhaseTimes)
+		{
+			const double Now = FPlatformTime::Seconds();
+			PhaseTimes->*PhaseTime += Now - PhaseStartTime;
+			PhaseStartTime = Now;
+		}
+	};
+
+	const int32 Width = Board.GetWidth();
+	const int32 Height = Board.GetHeight();
+	CurrentMatch = MatchingGridAddresses;
+	while (CurrentMatch.Num() > 0)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_Match3CascadeStep);
+		INC_DWORD_STAT(STAT_Match3CascadeStepsResolved);
+		FMatch3CascadeStep* Step = bRecordSteps ? &OutScript.Steps[OutScript.Steps.AddDefaulted()] : nullptr;
+		++OutScript.NumMatches;
+
+		// Scoring, as AGrid did when it scored each match as it was shown.
+		switch (MoveType)
+		{
+		case EMatch3MoveType::MT_Bomb:
+		case EMatch3MoveType::MT_AllTheBombs:
+			// Clear combo when bombing.
+			OutScript.ComboPower = 0;
+			break;
+		case EMatch3MoveType::MT_Combo:
+			// Power up combo!
+			OutScript.ComboPower = FMath::Min(Settings.MaxComboPower, OutScript.ComboPower + 1);
+			break;
+		}
+		const int32 StepScore = CurrentMatch.Num() * Settings.ScoreMultipliers[MoveType];
+		OutScript.Score += StepScore;
+
+		if (Step)
+		{
+			Step->MoveType = MoveType;
+			Step->MatchedGridAddresses = CurrentMatch;
+			Step->Score = StepScore;
+			Step->ComboPower = OutScript.ComboPower;
+		}
+		EndPhase(&FMatch3GamePhaseTimes::Matching);
+
+		// Gravity is worked out column by column, so every tile gets its landing space and the refill count without searching.
+		Board.CollapseColumns(CurrentMatch, FallingGridAddresses, LandingGridAddresses, RefillGridAddresses);
+		ChangedGridAddresses.Reset();
+		ChangedGridAddresses.Append(LandingGridAddresses);
+		if (Step)
+		{
+			Step->Falls.Reserve(FallingGridAddresses.Num());
+			for (int32 FallIndex = 0; FallIndex < FallingGridAddresses.Num(); ++FallIndex)
+			{
+				Step->Falls.Add(FMatch3CascadeFall(FallingGridAddresses[FallIndex], LandingGridAddresses[FallIndex], Board.GetTileType(LandingGridAddresses[FallIndex])));
+			}
+		}
+		EndPhase(&FMatch3GamePhaseTimes::Gravity);
+
+		// Refill the top of each column. New tiles start above the board, stacked so that the lowest one starts just above the top row.
+		int32 ColumnDepth = 0;
+		for (int32 RefillIndex = 0; RefillIndex < RefillGridAddresses.Num(); ++RefillIndex)
+		{
+			const int32 GridAddress = RefillGridAddresses[RefillIndex];
+			if ((RefillIndex == 0) || ((GridAddress % Width) != (RefillGridAddresses[RefillIndex - 1] % Width)))
+			{
+				// The first address in each column is its lowest empty space.
+				ColumnDepth = Height - (GridAddress / Width);
+			}
+			const int32 TileTypeID = TileSampler.Sample(RandomStream);
+			Board.SetTile(GridAddress, TileTypeID);
+			ChangedGridAddresses.Add(GridAddress);
+			if (Step)
+			{
+				Step->Spawns.Add(FMatch3CascadeSpawn(GridAddress, TileTypeID, ColumnDepth + 1));
+			}
+		}
+		OutScript.NumTilesSpawned += RefillGridAddresses.Num();
+		EndPhase(&FMatch3GamePhaseTimes::Refill);
+
+		// The board had no runs before this match, so any run on it now includes a tile that moved or was spawned.
+		Board.FindCascadeMatches(ChangedGridAddresses, CurrentMatch);
+		MoveType = EMatch3MoveType::MT_Combo;
+		EndPhase(&FMatch3GamePhaseTimes::Matching);
+	}
+}
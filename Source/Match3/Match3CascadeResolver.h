@@ -0,0 +1,100 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Match3Board.h"
+#include "Match3TileSampler.h"
+
+struct FMatch3GameSettings;
+struct FMatch3GamePhaseTimes;
+
+/** A tile that moves down its column to fill the space left by a match. */
+struct FMatch3CascadeFall
+{
+	int32 FromGridAddress;
+	int32 ToGridAddress;
+	/** Type of the falling tile, for spaces that have no tile actor to move. */
+	int32 TileTypeID;
+
+	FMatch3CascadeFall(int32 InFromGridAddress, int32 InToGridAddress, int32 InTileTypeID)
+		: FromGridAddress(InFromGridAddress)
+		, ToGridAddress(InToGridAddress)
+		, TileTypeID(InTileTypeID)
+	{
+	}
+};
+
+/** A new tile that drops into an empty space from above the board. */
+struct FMatch3CascadeSpawn
+{
+	int32 GridAddress;
+	int32 TileTypeID;
+	/** Number of rows above GridAddress that the tile starts falling from. */
+	int32 FallDistance;
+
+	FMatch3CascadeSpawn(int32 InGridAddress, int32 InTileTypeID, int32 InFallDistance)
+		: GridAddress(InGridAddress)
+		, TileTypeID(InTileTypeID)
+		, FallDistance(InFallDistance)
+	{
+	}
+};
+
+/** One match in a cascade and the board changes that follow it, in the order they should be shown. */
+struct FMatch3CascadeStep
+{
+	/** MT_Combo for every match after the first. */
+	EMatch3MoveType::Type MoveType;
+	/** Spaces whose tiles are removed by the match. */
+	TArray<int32> MatchedGridAddresses;
+	/** Points scored by the match. */
+	int32 Score;
+	/** Combo power once the match has been scored. */
+	int32 ComboPower;
+	/** Tiles that fall once the matched tiles are gone. */
+	TArray<FMatch3CascadeFall> Falls;
+	/** Tiles spawned once the falls have landed, in the order they were picked. */
+	TArray<FMatch3CascadeSpawn> Spawns;
+};
+
+/** Everything a move does to the board, worked out before any of it is shown. */
+struct MATCH3_API FMatch3CascadeScript
+{
+	/** Each match in order. Only filled if the resolver was asked to record steps. */
+	TArray<FMatch3CascadeStep> Steps;
+	/** Points scored by the whole cascade. */
+	int32 Score;
+	/** Combo power once the cascade is over. */
+	int32 ComboPower;
+	/** Number of matches, including the one that started the cascade. */
+	int32 NumMatches;
+	int32 NumTilesSpawned;
+
+	FMatch3CascadeScript();
+	void Reset();
+};
+
+/**
+ * Resolves a match and every cascade it causes in one call, leaving the board in its final state.
+ * Used by FMatch3HeadlessGame to play moves instantly, and by AGrid, which plays the resulting script back on its tile actors.
+ */
+class MATCH3_API FMatch3CascadeResolver
+{
+public:
+	/**
+	 * Remove the matched tiles, score them, let the tiles above fall, refill the board from RandomStream and repeat for any run that completes.
+	 * MoveType and ComboPower describe the move that made the first match. Steps are only recorded into OutScript if bRecordSteps is set.
+	 * If PhaseTimes is given, the time spent in each stage is added to it.
+	 */
+	void Resolve(FMatch3Board& Board, const FMatch3TileSampler& TileSampler, FRandomStream& RandomStream, const FMatch3GameSettings& Settings,
+		const TArray<int32>& MatchingGridAddresses, EMatch3MoveType::Type MoveType, int32 ComboPower,
+		FMatch3CascadeScript& OutScript, bool bRecordSteps = true, FMatch3GamePhaseTimes* PhaseTimes = nullptr);
+
+private:
+	/** Scratch space, kept between calls so that resolving a move doesn't allocate once the arrays have grown. */
+	TArray<int32> CurrentMatch;
+	TArray<int32> FallingGridAddresses;
+	TArray<int32> LandingGridAddresses;
+	TArray<int32> RefillGridAddresses;
+	TArray<int32> ChangedGridAddresses;
+};
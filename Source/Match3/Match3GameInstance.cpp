@@ -2,8 +2,16 @@
 
 #include "Match3.h"
 #include "Match3SaveGame.h"
+#include "Match3SaveWriter.h"
+#include "Match3PlayerController.h"
+#include "Match3SessionContext.h"
 #include "UnrealClient.h"
 #include "Match3GameInstance.h"
+#include "EngineUtils.h"
+#include "PlatformFeatures.h"
+#include "SaveGameSystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Save Board Snapshot"), STAT_Match3SaveBoardSnapshot, STATGROUP_Match3);
 
 UMatch3GameInstance::UMatch3GameInstance()
 {
@@ -13,24 +21,100 @@ UMatch3GameInstance::UMatch3GameInstance()
 bool UMatch3GameInstance::FindSaveDataForLevel(UObject* WorldContextObject, FMatch3LevelSaveData& OutSaveData)
 {
 	const FString LevelName = UGameplayStatics::GetCurrentLevelName(WorldContextObject, true);
-	if (FMatch3LevelSaveData* FoundData = InstanceGameData->Match3SaveData.Find(LevelName))
-	{
-		OutSaveData = *FoundData;
-		return true;
-	}
-	return false;
+	return InstanceGameData->FindLevelData(LevelName, OutSaveData);
 }
 
 void UMatch3GameInstance::UpdateSave(UObject* WorldContextObject, FMatch3LevelSaveData& NewData)
 {
 	const FString LevelName = UGameplayStatics::GetCurrentLevelName(WorldContextObject, true);
-	InstanceGameData->Match3SaveData.FindOrAdd(LevelName) = NewData;
+	InstanceGameData->SetLevelData(LevelName, NewData);
 	UpdateUIAfterSave();
 }
 
 void UMatch3GameInstance::SaveGame()
 {
-	UGameplayStatics::SaveGameToSlot(InstanceGameData, GetSaveSlotName(), 0);
+	// Serializing happens here, so later changes to InstanceGameData don't affect this save. Only the disk write is left to the background thread.
+	// Only the level records that changed since the last save are written.
+	InstanceGameData->WriteChanges(*SaveWriter, GetSaveSlotName(), 0);
+}
+
+void UMatch3GameInstance::FlushSaveGame()
+{
+	SaveWriter->Flush();
+}
+
+void UMatch3GameInstance::SaveBoardSnapshot(AGrid* Grid)
+{
+	SCOPE_CYCLE_COUNTER(STAT_Match3SaveBoardSnapshot);
+	AMatch3GameMode* GameMode = FMatch3SessionContext::GetGameMode(Grid);
+	AMatch3PlayerController* PC = FMatch3SessionContext::GetPlayerController(Grid);
+	if (!GameMode || !PC || !GameMode->IsGameActive())
+	{
+		return;
+	}
+	FMatch3BoardSnapshot Snapshot;
+	if (!Grid->GetSnapshot(Snapshot))
+	{
+		return;
+	}
+	Snapshot.LevelID = FMatch3LevelRecordStore::GetLevelID(UGameplayStatics::GetCurrentLevelName(Grid, true));
+	Snapshot.TimeRemaining = GameMode->GetGameTimeRemaining();
+	Snapshot.Score = PC->GetScore();
+	Snapshot.ComboPower = GameMode->GetComboPower();
+
+	TArray<uint8> Bytes;
+	Snapshot.Encode(Bytes);
+	SaveWriter->SaveData(FMatch3BoardSnapshot::GetSlotName(GetSaveSlotName()), 0, MoveTemp(Bytes));
+	// A newer game has been saved, so the one loaded at startup is no longer needed.
+	ResumeSnapshot = FMatch3BoardSnapshot();
+}
+
+void UMatch3GameInstance::ClearBoardSnapshot()
+{
+	TArray<uint8> Bytes;
+	FMatch3BoardSnapshot().Encode(Bytes);
+	SaveWriter->SaveData(FMatch3BoardSnapshot::GetSlotName(GetSaveSlotName()), 0, MoveTemp(Bytes));
+	ResumeSnapshot = FMatch3BoardSnapshot();
+}
+
+const FMatch3BoardSnapshot* UMatch3GameInstance::GetResumeSnapshot(UObject* WorldContextObject)
+{
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject);
+	if (!World || !ResumeSnapshot.IsValid())
+	{
+		return nullptr;
+	}
+	if (!ResumeWorld.IsExplicitlyNull() && (ResumeWorld.Get() != World))
+	{
+		// Another world already resumed this game, so this one is a fresh start.
+		ResumeSnapshot = FMatch3BoardSnapshot();
+		return nullptr;
+	}
+	if (ResumeSnapshot.LevelID != FMatch3LevelRecordStore::GetLevelID(UGameplayStatics::GetCurrentLevelName(WorldContextObject, true)))
+	{
+		return nullptr;
+	}
+	ResumeWorld = World;
+	return &ResumeSnapshot;
+}
+
+void UMatch3GameInstance::LoadBoardSnapshot()
+{
+	ResumeSnapshot = FMatch3BoardSnapshot();
+	ResumeWorld.Reset();
+	ISaveGameSystem* SaveSystem = IPlatformFeaturesModule::Get().GetSaveGameSystem();
+	const FString SlotName = FMatch3BoardSnapshot::GetSlotName(GetSaveSlotName());
+	TArray<uint8> Bytes;
+	if (SaveSystem && SaveSystem->DoesSaveGameExist(*SlotName, 0) && SaveSystem->LoadGame(false, *SlotName, 0, Bytes) && !ResumeSnapshot.Decode(Bytes))
+	{
+		UE_LOG(LogMatch3, Warning, TEXT("Couldn't read the board snapshot in save game slot %s."), *SlotName);
+	}
+}
+
+void UMatch3GameInstance::OnSaveGameWritten_Internal(const FString& SlotName, bool bSuccess)
+{
+	SaveGameWrittenEvent.Broadcast(SlotName, bSuccess);
+	OnSaveGameWritten(bSuccess);
 }
 
 bool UMatch3GameInstance::LoadCustomInt(FString FieldName, int32& Value)
@@ -53,12 +137,23 @@ void UMatch3GameInstance::ClearCustomInt(FString FieldName)
 
 void UMatch3GameInstance::Init()
 {
+	// Completion is reported through a weak pointer, since a write can outlive the game instance.
+	SaveWriter = MakeShareable(new FMatch3SaveWriter());
+	TWeakObjectPtr<UMatch3GameInstance> WeakThis(this);
+	SaveWriter->SetOnSaveCompleted([WeakThis](const FString& SlotName, bool bSuccess)
+	{
+		if (WeakThis.IsValid())
+		{
+			WeakThis->OnSaveGameWritten_Internal(SlotName, bSuccess);
+		}
+	});
+
 	// Point to a default save slot at startup. We will later change our save slot when we log in.
 	InitSaveGameSlot();
 
 	LoginChangedHandle = FCoreDelegates::OnUserLoginChangedEvent.AddUObject(this, &UMatch3GameInstance::OnLoginChanged);
 	EnteringForegroundHandle = FCoreDelegates::ApplicationHasEnteredForegroundDelegate.AddUObject(this, &UMatch3GameInstance::OnEnteringForeground);
-	EnteringBackgroundHandle = FCoreDelegates::ApplicationWillEnterBackgroundDelegate.AddUObject(this, &UMatch3GameInstance::OnEnteringBackground);
+	EnteringBackgroundHandle = FCoreDelegates::ApplicationWillEnterBackgroundDelegate.AddUObject(this, &UMatch3GameInstance::OnEnteringBackground_Internal);
 	ViewportHandle = FViewport::ViewportResizedEvent.AddUObject(this, &UMatch3GameInstance::OnViewportResize_Internal);
 
 	Super::Init();
@@ -69,16 +164,21 @@ void UMatch3GameInstance::Init()
 void UMatch3GameInstance::Shutdown()
 {
 	FCoreDelegates::OnUserLoginChangedEvent.Remove(LoginChangedHandle);
-	FCoreDelegates::OnUserLoginChangedEvent.Remove(EnteringForegroundHandle);
-	FCoreDelegates::OnUserLoginChangedEvent.Remove(EnteringBackgroundHandle);
+	FCoreDelegates::ApplicationHasEnteredForegroundDelegate.Remove(EnteringForegroundHandle);
+	FCoreDelegates::ApplicationWillEnterBackgroundDelegate.Remove(EnteringBackgroundHandle);
 	FViewport::ViewportResizedEvent.Remove(ViewportHandle);
-	
+
+	// Don't let the process exit with a save still in memory.
+	FlushSaveGame();
 
 	Super::Shutdown();
 }
 
 void UMatch3GameInstance::InitSaveGameSlot()
 {
+	// The slots on disk need to be up to date before they are checked, deleted or loaded.
+	FlushSaveGame();
+
 	const FString SaveSlotName = GetSaveSlotName();
 	if (!UGameplayStatics::DoesSaveGameExist(SaveSlotName, 0))
 	{
@@ -86,6 +186,12 @@ void UMatch3GameInstance::InitSaveGameSlot()
 		if (UGameplayStatics::DoesSaveGameExist(DefaultSaveGameSlot, 0))
 		{
 			UGameplayStatics::DeleteGameInSlot(DefaultSaveGameSlot, 0);
+			FMatch3LevelRecordStore::DeleteShards(DefaultSaveGameSlot, 0);
+			const FString BoardSnapshotSlotName = FMatch3BoardSnapshot::GetSlotName(DefaultSaveGameSlot);
+			if (UGameplayStatics::DoesSaveGameExist(BoardSnapshotSlotName, 0))
+			{
+				UGameplayStatics::DeleteGameInSlot(BoardSnapshotSlotName, 0);
+			}
 		}
 		// If we have no save object, create one.
 		if (InstanceGameData == nullptr)
@@ -93,12 +199,19 @@ void UMatch3GameInstance::InitSaveGameSlot()
 			// We're either not logged in with an Online ID, or we have no save data to transfer over (usually, this indicates program startup).
 			InstanceGameData = Cast<UMatch3SaveGame>(UGameplayStatics::CreateSaveGameObject(UMatch3SaveGame::StaticClass()));
 		}
-		UGameplayStatics::SaveGameToSlot(InstanceGameData, SaveSlotName, 0);
+		// Everything goes to the new slot, not just what changed since the last save.
+		InstanceGameData->MarkAllDirty();
+		SaveGame();
 	}
 	else
 	{
 		InstanceGameData = Cast<UMatch3SaveGame>(UGameplayStatics::LoadGameFromSlot(SaveSlotName, 0));
+		if (InstanceGameData)
+		{
+			InstanceGameData->LoadLevelRecords(SaveSlotName, 0);
+		}
 	}
+	LoadBoardSnapshot();
 	check(InstanceGameData);
 }
 
@@ -113,6 +226,20 @@ void UMatch3GameInstance::RegisterOnlineID(FString NewOnlineID)
 	InitSaveGameSlot();
 }
 
+void UMatch3GameInstance::OnEnteringBackground_Internal()
+{
+	// The application may be stopped at any point once it is in the background, so the game in progress is saved with the time it has left.
+	if (UWorld* World = GetWorld())
+	{
+		for (TActorIterator<AGrid> It(World); It; ++It)
+		{
+			SaveBoardSnapshot(*It);
+		}
+	}
+	FlushSaveGame();
+	OnEnteringBackground();
+}
+
 void UMatch3GameInstance::OnViewportResize_Internal(FViewport* Viewport, uint32 ID)
 {
 	OnViewportResize();
@@ -4,8 +4,14 @@
 
 #include "Engine/GameInstance.h"
 #include "Match3GameMode.h"
+#include "Match3BoardSnapshot.h"
 #include "Match3GameInstance.generated.h"
 
+class FMatch3SaveWriter;
+
+/** Called on the game thread when a save game slot has been written, or has failed to write. */
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnMatch3SaveGameWritten, const FString& /*SlotName*/, bool /*bSuccess*/);
+
 
 /**
  * 
@@ -30,10 +36,32 @@ public:
 	/** Load the current saved game, if it exists. */
 	bool FindSaveDataForLevel(UObject* WorldContextObject, FMatch3LevelSaveData& OutSaveData);
 
-	/** Save our game. All save game data is included. */
+	/** Save our game. Everything that changed since the last save is included. The data is copied immediately and written to disk in the background. */
 	UFUNCTION(BlueprintCallable, Category = "Saved Game")
 	void SaveGame();
 
+	/** Wait until every save made so far has been written to disk. */
+	void FlushSaveGame();
+
+	/** Save the state of the game being played on a grid, so it can be resumed if the application is stopped. Does nothing unless the board is settled and the game is running. */
+	void SaveBoardSnapshot(AGrid* Grid);
+
+	/** Record that no game is in progress, so the next run doesn't resume one. */
+	void ClearBoardSnapshot();
+
+	/**
+	 * The game interrupted in a previous run, if it was being played in the current level of WorldContextObject's world.
+	 * Only the first world that asks gets it, so a restarted level starts a new game.
+	 */
+	const FMatch3BoardSnapshot* GetResumeSnapshot(UObject* WorldContextObject);
+
+	/** Event for responding once a save slot has been written to disk. Level records are written to slots of their own, so one save may trigger this more than once. */
+	UFUNCTION(BlueprintImplementableEvent, Category = "Saved Game")
+	void OnSaveGameWritten(bool bSuccess);
+
+	/** Broadcast once a save slot has been written to disk. */
+	FOnMatch3SaveGameWritten SaveGameWrittenEvent;
+
 	/** Look up a custom int32 variable in our saved game. FieldName is not case-sensitive. */
 	UFUNCTION(BlueprintCallable, Category = "Saved Game")
 	bool LoadCustomInt(FString FieldName, int32& Value);
@@ -73,6 +101,9 @@ public:
 	UFUNCTION(BlueprintImplementableEvent, Category = "Online")
 	void OnEnteringBackground();
 
+	// Internal function to bind to the entering background delegate, so saves are on disk before the application can be stopped.
+	void OnEnteringBackground_Internal();
+
 	// Internal function to bind to viewport resizing delegate
 	void OnViewportResize_Internal(FViewport* Viewport, uint32 ID);
 
@@ -85,6 +116,19 @@ protected:
 	FString SaveGamePrefix;
 	FString DefaultSaveGameSlot;
 
+	/** Writes saves on a background thread. Shared with the writes in progress, which may finish after the game instance is gone. */
+	TSharedPtr<FMatch3SaveWriter, ESPMode::ThreadSafe> SaveWriter;
+
+	/** Read the board snapshot for the current save slot, if there is one. */
+	void LoadBoardSnapshot();
+	/** Game to resume, loaded with the save slot. Invalid once there is no game to resume. */
+	FMatch3BoardSnapshot ResumeSnapshot;
+	/** World that ResumeSnapshot was handed to. */
+	TWeakObjectPtr<UWorld> ResumeWorld;
+
+	/** Called on the game thread by SaveWriter. */
+	void OnSaveGameWritten_Internal(const FString& SlotName, bool bSuccess);
+
 private:
 	FDelegateHandle LoginChangedHandle;
 	FDelegateHandle EnteringForegroundHandle;
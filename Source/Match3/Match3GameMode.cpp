@@ -7,7 +7,12 @@
 #include "Match3PlayerController.h"
 #include "Match3GameInstance.h"
 #include "Match3SaveGame.h"
+#include "Match3SessionContext.h"
+#include "EngineUtils.h"
 
+DECLARE_DWORD_COUNTER_STAT(TEXT("HUD Blueprint Events"), STAT_Match3HUDBlueprintEvents, STATGROUP_Match3);
+DECLARE_DWORD_COUNTER_STAT(TEXT("HUD Text Rebuilds"), STAT_Match3HUDTextRebuilds, STATGROUP_Match3);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("HUD Score Events Last Update"), STAT_Match3HUDScoreEventsLastUpdate, STATGROUP_Match3);
 
 AMatch3GameMode::AMatch3GameMode(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
@@ -18,10 +23,17 @@ AMatch3GameMode::AMatch3GameMode(const FObjectInitializer& ObjectInitializer) :
 	TileMoveSpeed = 50.0f;
 	TimeRemaining = 5.0f;
 	FinalPlace = 0;
+	bHUDUpdatePending = false;
+	bBatchingHUDUpdates = false;
+	NumPendingScoreEvents = 0;
+	LastHUDPlace = 0;
+	CachedTimeSeconds = INDEX_NONE;
 }
 
 void AMatch3GameMode::BeginPlay()
 {
+	// Register before anything else in BeginPlay asks for the player controller.
+	FMatch3SessionContext::Register(this);
 	Super::BeginPlay();
 	bGameWillBeWon = false;
 	ChangeMenuWidget(StartingWidgetClass);
@@ -36,9 +48,58 @@ void AMatch3GameMode::BeginPlay()
 		{
 			GameInstance->UpdateSave(this, SaveGameData);
 		}
+
+		// Carry on a game that was interrupted in a previous run. The grid restores its own board, and accepts the snapshot under the same conditions checked here,
+		// so the score and timer are only carried over along with the board. A snapshot that doesn't fit is thrown away.
+		const FMatch3BoardSnapshot* Snapshot = GameInstance->GetResumeSnapshot(this);
+		if (Snapshot)
+		{
+			AGrid* Grid = nullptr;
+			for (TActorIterator<AGrid> It(GetWorld()); It; ++It)
+			{
+				Grid = *It;
+				break;
+			}
+			if (!Grid || !Grid->CanRestoreSnapshot(*Snapshot))
+			{
+				GameInstance->ClearBoardSnapshot();
+				Snapshot = nullptr;
+			}
+		}
+		if (Snapshot)
+		{
+			GetWorldTimerManager().SetTimer(GameOverTimer, this, &AMatch3GameMode::GameOver, FMath::Max(Snapshot->TimeRemaining, KINDA_SMALL_NUMBER), false);
+			SetComboPower(Snapshot->ComboPower);
+			if (AMatch3PlayerController* PC = FMatch3SessionContext::GetPlayerController(this))
+			{
+				PC->AddScore(Snapshot->Score, true);
+			}
+			bGameWillBeWon = (Snapshot->Score >= SaveGameData.BronzeScore);
+			FinalPlace = GetPlaceForScore(Snapshot->Score);
+			LastHUDPlace = FinalPlace;
+			SendHUDUpdate();
+		}
 	}
 }
 
+void AMatch3GameMode::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FMatch3SessionContext::Unregister(this);
+	Super::EndPlay(EndPlayReason);
+}
+
+void AMatch3GameMode::PostLogin(APlayerController* NewPlayer)
+{
+	FMatch3SessionContext::InvalidatePlayerController(this);
+	Super::PostLogin(NewPlayer);
+}
+
+void AMatch3GameMode::Logout(AController* Exiting)
+{
+	FMatch3SessionContext::InvalidatePlayerController(this);
+	Super::Logout(Exiting);
+}
+
 void AMatch3GameMode::GameRestart()
 {
 	ChangeMenuWidget(nullptr);
@@ -50,11 +111,17 @@ void AMatch3GameMode::GameOver()
 {
 	GetWorldTimerManager().ClearTimer(GameOverTimer);
 
+	// There is no longer a game to resume.
+	UMatch3GameInstance* GameInstance = Cast<UMatch3GameInstance>(UGameplayStatics::GetGameInstance(this));
+	if (GameInstance)
+	{
+		GameInstance->ClearBoardSnapshot();
+	}
+
 	if (bGameWillBeWon)
 	{
-		UMatch3GameInstance* GameInstance = Cast<UMatch3GameInstance>(UGameplayStatics::GetGameInstance(this));
 		// Check for top score
-		if (AMatch3PlayerController* PC = Cast<AMatch3PlayerController>(UMatch3BlueprintFunctionLibrary::GetLocalPlayerController(this)))
+		if (AMatch3PlayerController* PC = FMatch3SessionContext::GetPlayerController(this))
 		{
 			SaveGameData.TopScore = FMath::Max(PC->GetScore(), SaveGameData.TopScore);
 		}
@@ -87,11 +154,35 @@ void AMatch3GameMode::PauseGameTimer(bool bPause)
 
 FString AMatch3GameMode::GetRemainingTimeAsString()
 {
-	int32 OutInt = FMath::CeilToInt(GetWorldTimerManager().GetTimerRemaining(GameOverTimer));
-	return FString::Printf(TEXT("%03i"), FMath::Max(0, OutInt));
+	UpdateCachedTimeText();
+	return CachedTimeString;
+}
+
+FText AMatch3GameMode::GetRemainingTimeAsText()
+{
+	UpdateCachedTimeText();
+	return CachedTimeText;
+}
+
+void AMatch3GameMode::UpdateCachedTimeText()
+{
+	// Widgets poll this every frame, but the text only changes once a second.
+	const int32 Seconds = FMath::Max(0, FMath::CeilToInt(GetWorldTimerManager().GetTimerRemaining(GameOverTimer)));
+	if (Seconds != CachedTimeSeconds)
+	{
+		INC_DWORD_STAT(STAT_Match3HUDTextRebuilds);
+		CachedTimeSeconds = Seconds;
+		CachedTimeString = FString::Printf(TEXT("%03i"), Seconds);
+		CachedTimeText = FText::FromString(CachedTimeString);
+	}
 }
 
 
+float AMatch3GameMode::GetGameTimeRemaining() const
+{
+	return GetWorldTimerManager().GetTimerRemaining(GameOverTimer);
+}
+
 bool AMatch3GameMode::GetTimerPaused()
 {
 	return GetWorldTimerManager().IsTimerPaused(GameOverTimer);
@@ -99,7 +190,7 @@ bool AMatch3GameMode::GetTimerPaused()
 
 void AMatch3GameMode::AddScore(int32 Points)
 {
-	if (AMatch3PlayerController* PC = Cast<AMatch3PlayerController>(UMatch3BlueprintFunctionLibrary::GetLocalPlayerController(this)))
+	if (AMatch3PlayerController* PC = FMatch3SessionContext::GetPlayerController(this))
 	{
 		int32 OldScore = PC->GetScore();
 		PC->AddScore(Points);
@@ -110,27 +201,11 @@ void AMatch3GameMode::AddScore(int32 Points)
 		}
 
 		// Check for medals
-		if (NewScore > SaveGameData.GoldScore)
-		{
-			FinalPlace = 1;
-			AwardPlace(1, Points);
-		}
-		else if (NewScore > SaveGameData.SilverScore)
-		{
-			FinalPlace = 2;
-			AwardPlace(2, Points);
-		}
-		else if (NewScore > SaveGameData.BronzeScore)
-		{
-			FinalPlace = 3;
-			AwardPlace(3, Points);
-		}
-		else
-		{
-			FinalPlace = 0;
-			AwardPlace(0, Points);
-		}
-		
+		FinalPlace = GetPlaceForScore(NewScore);
+		PendingHUDUpdate.PointsGiven += Points;
+		bHUDUpdatePending = true;
+		++NumPendingScoreEvents;
+
 		for (const FMatch3Reward& Reward : Rewards)
 		{
 			check(Reward.ScoreInterval > 0);
@@ -142,13 +217,85 @@ void AMatch3GameMode::AddScore(int32 Points)
 				if (StartingTimeValue >= 0.0f)
 				{
 					GetWorldTimerManager().SetTimer(GameOverTimer, this, &AMatch3GameMode::GameOver, StartingTimeValue + (ScoreAwardCount * Reward.TimeAwarded), false);
-					AwardBonus();
+					PendingHUDUpdate.TimeAwarded += ScoreAwardCount * Reward.TimeAwarded;
 				}
 			}
 		}
+
+		if (!bBatchingHUDUpdates)
+		{
+			SendHUDUpdate();
+		}
+	}
+}
+
+void AMatch3GameMode::BeginHUDUpdate()
+{
+	bBatchingHUDUpdates = true;
+}
+
+void AMatch3GameMode::EndHUDUpdate()
+{
+	bBatchingHUDUpdates = false;
+	if (bHUDUpdatePending)
+	{
+		SendHUDUpdate();
 	}
 }
 
+void AMatch3GameMode::SendHUDUpdate()
+{
+	PendingHUDUpdate.Score = 0;
+	if (AMatch3PlayerController* PC = FMatch3SessionContext::GetPlayerController(this))
+	{
+		PendingHUDUpdate.Score = PC->GetScore();
+	}
+	PendingHUDUpdate.Place = FinalPlace;
+	PendingHUDUpdate.bPlaceChanged = (FinalPlace != LastHUDPlace);
+	PendingHUDUpdate.ComboPower = GetComboPower();
+	LastHUDPlace = FinalPlace;
+
+	// Blueprints written before OnHUDUpdate still get the events they expect, once per batch.
+	static const FName OnHUDUpdateName(GET_FUNCTION_NAME_CHECKED(AMatch3GameMode, OnHUDUpdate));
+	if (GetClass()->IsFunctionImplementedInBlueprint(OnHUDUpdateName))
+	{
+		INC_DWORD_STAT(STAT_Match3HUDBlueprintEvents);
+		OnHUDUpdate(PendingHUDUpdate);
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_Match3HUDBlueprintEvents);
+		AwardPlace(PendingHUDUpdate.Place, PendingHUDUpdate.PointsGiven);
+		if (PendingHUDUpdate.TimeAwarded > 0.0f)
+		{
+			INC_DWORD_STAT(STAT_Match3HUDBlueprintEvents);
+			AwardBonus();
+		}
+	}
+	// Before batching, each of these score events sent its own AwardPlace.
+	SET_DWORD_STAT(STAT_Match3HUDScoreEventsLastUpdate, NumPendingScoreEvents);
+	NumPendingScoreEvents = 0;
+	PendingHUDUpdate = FMatch3HUDUpdate();
+	bHUDUpdatePending = false;
+}
+
+int32 AMatch3GameMode::GetPlaceForScore(int32 Score) const
+{
+	if (Score > SaveGameData.GoldScore)
+	{
+		return 1;
+	}
+	else if (Score > SaveGameData.SilverScore)
+	{
+		return 2;
+	}
+	else if (Score > SaveGameData.BronzeScore)
+	{
+		return 3;
+	}
+	return 0;
+}
+
 void AMatch3GameMode::UpdateScoresFromLeaderBoard(int32 GoldScore, int32 SilverScore, int32 BronzeScore)
 {
 	UMatch3GameInstance* GameInstance = Cast<UMatch3GameInstance>(UGameplayStatics::GetGameInstance(this));
@@ -162,7 +309,7 @@ void AMatch3GameMode::UpdateScoresFromLeaderBoard(int32 GoldScore, int32 SilverS
 
 void AMatch3GameMode::SetComboPower(int32 NewComboPower)
 {
-	if (AMatch3PlayerController* PC = Cast<AMatch3PlayerController>(UMatch3BlueprintFunctionLibrary::GetLocalPlayerController(this)))
+	if (AMatch3PlayerController* PC = FMatch3SessionContext::GetPlayerController(this))
 	{
 		PC->ComboPower = NewComboPower;
 	}
@@ -170,7 +317,7 @@ void AMatch3GameMode::SetComboPower(int32 NewComboPower)
 
 int32 AMatch3GameMode::GetComboPower()
 {
-	if (AMatch3PlayerController* PC = Cast<AMatch3PlayerController>(UMatch3BlueprintFunctionLibrary::GetLocalPlayerController(this)))
+	if (AMatch3PlayerController* PC = FMatch3SessionContext::GetPlayerController(this))
 	{
 		return PC->ComboPower;
 	}
@@ -179,7 +326,7 @@ int32 AMatch3GameMode::GetComboPower()
 
 int32 AMatch3GameMode::GetMaxComboPower()
 {
-	if (AMatch3PlayerController* PC = Cast<AMatch3PlayerController>(UMatch3BlueprintFunctionLibrary::GetLocalPlayerController(this)))
+	if (AMatch3PlayerController* PC = FMatch3SessionContext::GetPlayerController(this))
 	{
 		return PC->MaxComboPower;
 	}
@@ -188,7 +335,7 @@ int32 AMatch3GameMode::GetMaxComboPower()
 
 int32 AMatch3GameMode::CalculateBombPower_Implementation()
 {
-	if (AMatch3PlayerController* PC = Cast<AMatch3PlayerController>(UMatch3BlueprintFunctionLibrary::GetLocalPlayerController(this)))
+	if (AMatch3PlayerController* PC = FMatch3SessionContext::GetPlayerController(this))
 	{
 		return PC->CalculateBombPower();
 	}
@@ -204,7 +351,7 @@ void AMatch3GameMode::ChangeMenuWidget(TSubclassOf<UUserWidget> NewWidgetClass)
 	}
 	if (NewWidgetClass)
 	{
-		if (AMatch3PlayerController* PC = Cast<AMatch3PlayerController>(UMatch3BlueprintFunctionLibrary::GetLocalPlayerController(this)))
+		if (AMatch3PlayerController* PC = FMatch3SessionContext::GetPlayerController(this))
 		{
 			CurrentWidget = CreateWidget<UUserWidget>(PC, NewWidgetClass);
 			if (CurrentWidget)
@@ -23,6 +23,45 @@ struct FMatch3Reward
 	float TimeAwarded;
 };
 
+/** Everything about the game's score, medals and timer that changed since the HUD was last told. */
+USTRUCT(BlueprintType)
+struct FMatch3HUDUpdate
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Actual score, not the one being counted up on screen. */
+	UPROPERTY(BlueprintReadOnly)
+	int32 Score;
+
+	/** Points scored since the last update. */
+	UPROPERTY(BlueprintReadOnly)
+	int32 PointsGiven;
+
+	/** 1 to 3 for gold to bronze, or 0 for no medal. */
+	UPROPERTY(BlueprintReadOnly)
+	int32 Place;
+
+	/** True if Place is different from the last update. */
+	UPROPERTY(BlueprintReadOnly)
+	bool bPlaceChanged;
+
+	/** Seconds added to the timer by rewards since the last update. */
+	UPROPERTY(BlueprintReadOnly)
+	float TimeAwarded;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 ComboPower;
+
+	FMatch3HUDUpdate()
+		: Score(0)
+		, PointsGiven(0)
+		, Place(0)
+		, bPlaceChanged(false)
+		, TimeAwarded(0.0f)
+		, ComboPower(0)
+	{
+	}
+};
 
 /**
  * 
@@ -37,6 +76,11 @@ public:
 
 	/** Called when the game starts. */
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Players joining or leaving change which player controller the session context hands out. */
+	virtual void PostLogin(APlayerController* NewPlayer) override;
+	virtual void Logout(AController* Exiting) override;
 
 	/** Remove the current menu widget and create a new one from the specified class, if provided. */
 	UFUNCTION(BlueprintCallable, Category = "Game")
@@ -66,10 +110,20 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Game")
 	TArray<FMatch3Reward> Rewards;
 
-	/** Get remaining game time. */
+	/** Get remaining game time. The string is only rebuilt when the number of whole seconds shown changes. */
 	UFUNCTION(BlueprintCallable, Category = "Game")
 	FString GetRemainingTimeAsString();
 
+	/** Get remaining game time as text, for binding to a text widget. The text is only rebuilt when the number of whole seconds shown changes, and can be returned without copying its string. */
+	UFUNCTION(BlueprintPure, Category = "Game")
+	FText GetRemainingTimeAsText();
+
+	/** Length of a game before any time is awarded. */
+	float GetStartingTime() const { return TimeRemaining; }
+
+	/** Seconds until the game ends. */
+	float GetGameTimeRemaining() const;
+
 	/** Get remaining game time. */
 	UFUNCTION(BlueprintCallable, Category = "Game")
 	bool GetTimerPaused();
@@ -82,9 +136,21 @@ public:
 	UFUNCTION(BlueprintImplementableEvent, Category = "Game")
 	void AwardBonus();
 
-	/** The game mode handles point-scoring. */
+	/**
+	 * Notifies once for every batch of score, medal and timer changes, such as those from a whole cascade. If this is implemented, AwardPlace and AwardBonus are not called.
+	 * Use it to refresh the HUD in one go.
+	 */
+	UFUNCTION(BlueprintImplementableEvent, Category = "Game")
+	void OnHUDUpdate(const FMatch3HUDUpdate& Update);
+
+	/** The game mode handles point-scoring. Unless a batch has been started with BeginHUDUpdate, the HUD is told straight away. */
 	void AddScore(int32 Points);
 
+	/** Hold back HUD events until EndHUDUpdate, so that the changes in between are sent as one. */
+	void BeginHUDUpdate();
+	/** Send the changes made since BeginHUDUpdate, if there were any. */
+	void EndHUDUpdate();
+
 	/** The game mode understands the concept of combo power. */
 	void SetComboPower(int32 NewComboPower);
 
@@ -139,6 +205,29 @@ protected:
 
 	FTimerHandle GameOverTimer;
 
+	/** Place a score would earn: 1 to 3 for gold to bronze, or 0 for none. */
+	int32 GetPlaceForScore(int32 Score) const;
+
+	/** Send PendingHUDUpdate to OnHUDUpdate, or to AwardPlace and AwardBonus if OnHUDUpdate isn't implemented. */
+	void SendHUDUpdate();
+	/** Changes that the HUD hasn't been told about yet. */
+	FMatch3HUDUpdate PendingHUDUpdate;
+	/** True if PendingHUDUpdate holds changes. */
+	bool bHUDUpdatePending;
+	/** Number of AddScore calls folded into PendingHUDUpdate. */
+	int32 NumPendingScoreEvents;
+	/** True between BeginHUDUpdate and EndHUDUpdate. */
+	bool bBatchingHUDUpdates;
+	/** Place sent with the last HUD update. */
+	int32 LastHUDPlace;
+
+	/** Remaining time, in the whole seconds shown, that the cached time text was built for. */
+	int32 CachedTimeSeconds;
+	FString CachedTimeString;
+	FText CachedTimeText;
+	/** Rebuild the cached time text if the whole seconds shown have changed. */
+	void UpdateCachedTimeText();
+
 	bool bGameWillBeWon;
 
 
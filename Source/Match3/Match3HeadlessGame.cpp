@@ -0,0 +1,175 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "Match3.h"
+#include "Match3HeadlessGame.h"
+
+FMatch3GameSettings::FMatch3GameSettings()
+	: Width(8)
+	, Height(8)
+	, MinimumRunLength(3)
+	, InitialComboPower(0)
+	, MaxComboPower(0)
+	, bReshuffleOnDeadlock(false)
+{
+	// Matches AGrid::GetScoreMultiplierForMove.
+	for (int32& ScoreMultiplier : ScoreMultipliers)
+	{
+		ScoreMultiplier = 100;
+	}
+}
+
+FMatch3HeadlessGame::FMatch3HeadlessGame()
+	: Score(0)
+	, ComboPower(0)
+	, SelectedGridAddress(INDEX_NONE)
+	, LastMove(EMatch3MoveType::MT_None)
+	, bGameOver(false)
+	, bCollectPhaseTimes(false)
+	, NumMoves(0)
+	, NumMatches(0)
+	, NumCascades(0)
+	, NumTilesSpawned(0)
+	, MaxCascadeDepth(0)
+	, NumReshuffles(0)
+{
+}
+
+void FMatch3HeadlessGame::Reset(const FMatch3GameSettings& InSettings, int32 Seed)
+{
+	Settings = InSettings;
+	Score = 0;
+	ComboPower = Settings.InitialComboPower;
+	SelectedGridAddress = INDEX_NONE;
+	LastMove = EMatch3MoveType::MT_None;
+	bGameOver = false;
+	NumMoves = 0;
+	NumMatches = 0;
+	NumCascades = 0;
+	NumTilesSpawned = 0;
+	MaxCascadeDepth = 0;
+	NumReshuffles = 0;
+	PhaseTimes = FMatch3GamePhaseTimes();
+
+	Board.Init(Settings.Width, Settings.Height, Settings.MinimumRunLength);
+	Board.SetTileTypes(Settings.TileTypes);
+	TileSampler.Init(Settings.TileTypes);
+	RandomStream.Initialize(Seed);
+}
+
+void FMatch3HeadlessGame::Init(const FMatch3GameSettings& InSettings, int32 Seed)
+{
+	Reset(InSettings, Seed);
+
+	// Same steps as AGrid::InitGrid, so both draw the same values from the random stream.
+	TileSampler.FillBoard(Board, RandomStream);
+	if (Board.IsUnwinnable())
+	{
+		TileSampler.AddLegalMove(Board, RandomStream);
+	}
+	MoveIndex.Rebuild(Board);
+	bGameOver = !MoveIndex.HasLegalMove();
+}
+
+void FMatch3HeadlessGame::InitFromBoard(const FMatch3GameSettings& InSettings, int32 Seed, const TArray<uint8>& TileTypes, int32 InScore, int32 InComboPower)
+{
+	Reset(InSettings, Seed);
+	check(TileTypes.Num() == Board.GetNumSpaces());
+	for (int32 GridAddress = 0; GridAddress < Board.GetNumSpaces(); ++GridAddress)
+	{
+		Board.SetTile(GridAddress, TileTypes[GridAddress]);
+	}
+	Score = InScore;
+	ComboPower = InComboPower;
+	MoveIndex.Rebuild(Board);
+	bGameOver = !MoveIndex.HasLegalMove();
+}
+
+bool FMatch3HeadlessGame::SelectTile(int32 GridAddress, int32 BombPowerBonus)
+{
+	if (bGameOver || !Board.IsValidAddress(GridAddress) || Board.IsEmpty(GridAddress))
+	{
+		return false;
+	}
+
+	const FMatch3BoardTileType& TileType = Board.GetTileTypes()[Board.GetTileType(GridAddress)];
+	if (SelectedGridAddress != INDEX_NONE)
+	{
+		// Selecting a swappable neighbor attempts a move. Whatever happens, the first tile is no longer selected.
+		const int32 FirstGridAddress = SelectedGridAddress;
+		SelectedGridAddress = INDEX_NONE;
+		TArray<int32> MatchingGridAddresses;
+		if (Board.AreAddressesNeighbors(FirstGridAddress, GridAddress) && TileType.CanSwap() && Board.IsMoveLegal(FirstGridAddress, GridAddress, &MatchingGridAddresses))
+		{
+			Board.SwapTiles(FirstGridAddress, GridAddress);
+			LastMove = (MatchingGridAddresses.Num() > Settings.MinimumRunLength) ? EMatch3MoveType::MT_MoreTiles : EMatch3MoveType::MT_Standard;
+			ExecuteMatch(MatchingGridAddresses);
+		}
+	}
+	else if (TileType.CanExplode())
+	{
+		TArray<int32> TilesToDestroy;
+		if (ComboPower == Settings.MaxComboPower)
+		{
+			// Detonate every bomb of this type at once.
+			LastMove = EMatch3MoveType::MT_AllTheBombs;
+			TArray<int32> Bombs;
+			Board.FindTilesOfType(Board.GetTileType(GridAddress), Bombs);
+			FMatch3AddressSet TilesToDestroySet;
+			TilesToDestroySet.Init(Board.GetNumSpaces());
+			TArray<int32> TilesToDestroyForCurrentBomb;
+			for (int32 Bomb : Bombs)
+			{
+				const int32 BombPower = Board.GetTileTypes()[Board.GetTileType(Bomb)].BombPower;
+				Board.GetExplosionList(Bomb, FMath::Max(1, BombPower + 1 + BombPowerBonus), TilesToDestroyForCurrentBomb);
+				TilesToDestroySet.Append(TilesToDestroyForCurrentBomb);
+			}
+			TilesToDestroySet.GetGridAddresses(TilesToDestroy);
+		}
+		if (TilesToDestroy.Num() == 0)
+		{
+			LastMove = EMatch3MoveType::MT_Bomb;
+			Board.GetExplosionList(GridAddress, FMath::Max(1, TileType.BombPower + 1 + BombPowerBonus), TilesToDestroy);
+		}
+		ExecuteMatch(TilesToDestroy);
+	}
+	else if (TileType.CanSwap())
+	{
+		SelectedGridAddress = GridAddress;
+	}
+	return true;
+}
+
+void FMatch3HeadlessGame::ExecuteMatch(const TArray<int32>& MatchingGridAddresses)
+{
+	if (MatchingGridAddresses.Num() == 0)
+	{
+		return;
+	}
+	++NumMoves;
+
+	// Nothing is shown, so the steps of the cascade aren't kept.
+	CascadeResolver.Resolve(Board, TileSampler, RandomStream, Settings, MatchingGridAddresses, LastMove, ComboPower, CascadeScript, false, bCollectPhaseTimes ? &PhaseTimes : nullptr);
+	Score += CascadeScript.Score;
+	ComboPower = CascadeScript.ComboPower;
+	NumMatches += CascadeScript.NumMatches;
+	NumCascades += CascadeScript.NumMatches - 1;
+	NumTilesSpawned += CascadeScript.NumTilesSpawned;
+	MaxCascadeDepth = FMath::Max(MaxCascadeDepth, CascadeScript.NumMatches);
+	if (CascadeScript.NumMatches > 1)
+	{
+		LastMove = EMatch3MoveType::MT_Combo;
+	}
+
+	const double DeadlockCheckStartTime = bCollectPhaseTimes ? FPlatformTime::Seconds() : 0.0;
+	MoveIndex.Update(Board);
+	if (!MoveIndex.HasLegalMove() && Settings.bReshuffleOnDeadlock && Board.Reshuffle(RandomStream, ReshuffleSources))
+	{
+		++NumReshuffles;
+		MoveIndex.Update(Board);
+	}
+	bGameOver = !MoveIndex.HasLegalMove();
+	if (bCollectPhaseTimes)
+	{
+		PhaseTimes.DeadlockCheck += FPlatformTime::Seconds() - DeadlockCheckStartTime;
+	}
+}
@@ -0,0 +1,150 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Match3Board.h"
+#include "Match3MoveIndex.h"
+#include "Match3TileSampler.h"
+#include "Match3CascadeResolver.h"
+
+/** Everything about a game's setup that affects how it plays out. */
+struct MATCH3_API FMatch3GameSettings
+{
+	int32 Width;
+	int32 Height;
+	int32 MinimumRunLength;
+
+	/** Rule data for each tile type, in TileLibrary order. */
+	TArray<FMatch3BoardTileType> TileTypes;
+
+	/** Points per matched tile for each move type, indexed by EMatch3MoveType. */
+	int32 ScoreMultipliers[EMatch3MoveType::MT_MAX];
+
+	/** Combo power at the start of the game. */
+	int32 InitialComboPower;
+
+	/** Combo power at which selecting a bomb detonates every bomb of its type. */
+	int32 MaxComboPower;
+
+	/** Rearrange the tiles when no moves are left, instead of ending the game. */
+	bool bReshuffleOnDeadlock;
+
+	FMatch3GameSettings();
+};
+
+/** Time spent in each stage of resolving moves, in seconds. Only gathered when a game is asked to. */
+struct FMatch3GamePhaseTimes
+{
+	/** Removing and scoring matched tiles, and finding cascades. */
+	double Matching;
+	/** Moving tiles down into empty spaces. */
+	double Gravity;
+	/** Spawning new tiles. */
+	double Refill;
+	/** Updating the move index and checking for a board with no moves left. */
+	double DeadlockCheck;
+
+	FMatch3GamePhaseTimes()
+		: Matching(0.0)
+		, Gravity(0.0)
+		, Refill(0.0)
+		, DeadlockCheck(0.0)
+	{
+	}
+
+	FMatch3GamePhaseTimes& operator+=(const FMatch3GamePhaseTimes& Other)
+	{
+		Matching += Other.Matching;
+		Gravity += Other.Gravity;
+		Refill += Other.Refill;
+		DeadlockCheck += Other.DeadlockCheck;
+		return *this;
+	}
+};
+
+/**
+ * A whole game of match-3 with no world, actors or animation. Uses the same board rules, tile generation and refill order as AGrid, so a game started
+ * with the same settings and seed and given the same tile selections ends with the same board and score. Each selection is resolved completely,
+ * including every cascade it causes, before SelectTile returns.
+ */
+class MATCH3_API FMatch3HeadlessGame
+{
+public:
+	FMatch3HeadlessGame();
+
+	/** Start a new game, filling the board the same way AGrid::InitGrid does. */
+	void Init(const FMatch3GameSettings& InSettings, int32 Seed);
+
+	/** Carry on a game from a board of tile types in grid address order, as AGrid does when it restores a board snapshot. */
+	void InitFromBoard(const FMatch3GameSettings& InSettings, int32 Seed, const TArray<uint8>& TileTypes, int32 InScore, int32 InComboPower);
+
+	/**
+	 * Play the selection of the tile at GridAddress, as AGrid::OnTileWasSelected would.
+	 * BombPowerBonus is the game mode's bomb power bonus at the time, and is only used if the selection detonates a bomb.
+	 * Returns false if the selection was ignored because the game is over or the space is empty.
+	 */
+	bool SelectTile(int32 GridAddress, int32 BombPowerBonus = 0);
+
+	const FMatch3GameSettings& GetSettings() const { return Settings; }
+	const FMatch3Board& GetBoard() const { return Board; }
+	/** Every move available to the player. Always up to date between calls to SelectTile. */
+	const FMatch3MoveIndex& GetMoveIndex() const { return MoveIndex; }
+	int32 GetScore() const { return Score; }
+	int32 GetComboPower() const { return ComboPower; }
+	/** Grid address of the tile waiting to be swapped, or INDEX_NONE. */
+	int32 GetSelectedGridAddress() const { return SelectedGridAddress; }
+	EMatch3MoveType::Type GetLastMove() const { return LastMove; }
+	/** True once the board has no moves left. */
+	bool IsGameOver() const { return bGameOver; }
+
+	/** Number of swaps and bomb detonations played so far. */
+	int32 GetNumMoves() const { return NumMoves; }
+	/** Number of matches resolved so far, including cascades. */
+	int32 GetNumMatches() const { return NumMatches; }
+	/** Number of matches that completed on their own after tiles fell or spawned. */
+	int32 GetNumCascades() const { return NumCascades; }
+	/** Number of tiles spawned to refill the board so far. */
+	int32 GetNumTilesSpawned() const { return NumTilesSpawned; }
+	/** Most matches resolved by a single move so far, counting the one the move made. */
+	int32 GetMaxCascadeDepth() const { return MaxCascadeDepth; }
+	/** Number of times the board ran out of moves and was reshuffled. */
+	int32 GetNumReshuffles() const { return NumReshuffles; }
+
+	/** Time how long each stage of resolving a move takes. Off by default, since it reads the clock several times per match. */
+	void SetCollectPhaseTimes(bool bCollect) { bCollectPhaseTimes = bCollect; }
+	/** Time spent in each stage since the game was initialized. */
+	const FMatch3GamePhaseTimes& GetPhaseTimes() const { return PhaseTimes; }
+
+private:
+	/** Forget the previous game and set up an empty board and the random stream. */
+	void Reset(const FMatch3GameSettings& InSettings, int32 Seed);
+
+	/** Resolve the match and every cascade it causes, then check whether any moves are left. */
+	void ExecuteMatch(const TArray<int32>& MatchingGridAddresses);
+
+	FMatch3GameSettings Settings;
+	FMatch3Board Board;
+	FMatch3MoveIndex MoveIndex;
+	FMatch3TileSampler TileSampler;
+	FRandomStream RandomStream;
+	FMatch3CascadeResolver CascadeResolver;
+	/** Result of the most recent move. Kept so its arrays are reused. */
+	FMatch3CascadeScript CascadeScript;
+
+	int32 Score;
+	int32 ComboPower;
+	int32 SelectedGridAddress;
+	EMatch3MoveType::Type LastMove;
+	bool bGameOver;
+	bool bCollectPhaseTimes;
+
+	int32 NumMoves;
+	int32 NumMatches;
+	int32 NumCascades;
+	int32 NumTilesSpawned;
+	int32 MaxCascadeDepth;
+	int32 NumReshuffles;
+	/** Where each tile came from in the most recent reshuffle. */
+	TArray<int32> ReshuffleSources;
+	FMatch3GamePhaseTimes PhaseTimes;
+};
@@ -0,0 +1,106 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "Match3.h"
+#include "Match3HintEngine.h"
+
+namespace Match3Hints
+{
+	/** Number of moves evaluated between checks of the clock. */
+	static const int32 MovesPerTimeCheck = 8;
+
+	/** Lowest row of any address in the list. */
+	static int32 GetLowestRow(const FMatch3Board& Board, const TArray<int32>& GridAddresses)
+	{
+		int32 LowestRow = Board.GetHeight();
+		for (int32 GridAddress : GridAddresses)
+		{
+			LowestRow = FMath::Min(LowestRow, GridAddress / Board.GetWidth());
+		}
+		return LowestRow;
+	}
+
+	void FindBestMove(const FMatch3HintRequest& Request, FMatch3Hint& OutHint)
+	{
+		OutHint = FMatch3Hint();
+		const FMatch3Board& Board = Request.Board;
+		const FMatch3MoveIndex& MoveIndex = Request.MoveIndex;
+		const FMatch3GameSettings& Settings = Request.Settings;
+		const double EndTime = (Request.TimeBudget > 0.0) ? (FPlatformTime::Seconds() + Request.TimeBudget) : 0.0;
+
+		int32 BestLowestRow = MAX_int32;
+		auto ConsiderMove = [&](int32 GridAddressA, int32 GridAddressB, int32 Score, int32 LowestRow)
+		{
+			if ((Score > OutHint.Score) || ((Score == OutHint.Score) && (LowestRow < BestLowestRow)) || !OutHint.IsValid())
+			{
+				OutHint.GridAddressA = GridAddressA;
+				OutHint.GridAddressB = GridAddressB;
+				OutHint.Score = Score;
+				BestLowestRow = LowestRow;
+			}
+		};
+		auto IsOutOfTime = [&]()
+		{
+			// The first move is always evaluated, so a tiny budget still gives a hint.
+			return (EndTime > 0.0) && ((OutHint.NumMovesEvaluated % MovesPerTimeCheck) == 0) && (FPlatformTime::Seconds() >= EndTime);
+		};
+
+		// Swaps, checked on the board as it would be after the swap. Nothing on the board is moved.
+		TArray<int32> Match;
+		for (int32 SwapIndex = 0; SwapIndex < MoveIndex.GetNumLegalSwaps(); ++SwapIndex)
+		{
+			if (OutHint.IsValid() && IsOutOfTime())
+			{
+				return;
+			}
+			int32 GridAddressA, GridAddressB;
+			MoveIndex.GetLegalSwap(SwapIndex, GridAddressA, GridAddressB);
+			Board.IsMoveLegal(GridAddressA, GridAddressB, &Match);
+			const EMatch3MoveType::Type MoveType = (Match.Num() > Settings.MinimumRunLength) ? EMatch3MoveType::MT_MoreTiles : EMatch3MoveType::MT_Standard;
+			ConsiderMove(GridAddressA, GridAddressB, Match.Num() * Settings.ScoreMultipliers[MoveType], GetLowestRow(Board, Match));
+			++OutHint.NumMovesEvaluated;
+		}
+
+		// Bombs, scored the way FMatch3HeadlessGame::SelectTile would detonate them.
+		if (MoveIndex.GetNumBombs() > 0)
+		{
+			const bool bAllTheBombs = (Settings.InitialComboPower == Settings.MaxComboPower);
+			FMatch3AddressSet Explosion;
+			Explosion.Init(Board.GetNumSpaces());
+			TArray<int32> Bombs;
+			for (int32 GridAddress = 0; GridAddress < Board.GetNumSpaces(); ++GridAddress)
+			{
+				if (!MoveIndex.IsBomb(GridAddress))
+				{
+					continue;
+				}
+				if (OutHint.IsValid() && IsOutOfTime())
+				{
+					return;
+				}
+
+				// Every bomb of this type goes off at full combo power. Otherwise only this one does.
+				Explosion.Reset();
+				Bombs.Reset();
+				if (bAllTheBombs)
+				{
+					Board.FindTilesOfType(Board.GetTileType(GridAddress), Bombs);
+				}
+				else
+				{
+					Bombs.Add(GridAddress);
+				}
+				for (int32 Bomb : Bombs)
+				{
+					const int32 BombPower = Board.GetTileTypes()[Board.GetTileType(Bomb)].BombPower;
+					Board.GetExplosionList(Bomb, FMath::Max(1, BombPower + 1 + Request.BombPowerBonus), Match);
+					Explosion.Append(Match);
+				}
+				Explosion.GetGridAddresses(Match);
+				const EMatch3MoveType::Type MoveType = bAllTheBombs ? EMatch3MoveType::MT_AllTheBombs : EMatch3MoveType::MT_Bomb;
+				ConsiderMove(GridAddress, INDEX_NONE, Match.Num() * Settings.ScoreMultipliers[MoveType], GetLowestRow(Board, Match));
+				++OutHint.NumMovesEvaluated;
+			}
+		}
+		OutHint.bSearchComplete = true;
+	}
+}
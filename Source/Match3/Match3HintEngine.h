@@ -0,0 +1,58 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Match3HeadlessGame.h"
+
+/** Everything the hint search needs, copied from the game so the search can run on any thread. */
+struct FMatch3HintRequest
+{
+	FMatch3Board Board;
+	/** Must be up to date with Board. */
+	FMatch3MoveIndex MoveIndex;
+	/** Score multipliers and combo settings. InitialComboPower holds the current combo power. */
+	FMatch3GameSettings Settings;
+	/** The game mode's bomb power bonus. */
+	int32 BombPowerBonus;
+	/** Time the search may take before it settles for the best move found so far, in seconds. Zero or less means no limit. */
+	double TimeBudget;
+
+	FMatch3HintRequest()
+		: BombPowerBonus(0)
+		, TimeBudget(0.0)
+	{
+	}
+};
+
+/** The move a hint suggests: a swap between two neighbors, or a bomb detonation if GridAddressB is INDEX_NONE. */
+struct FMatch3Hint
+{
+	int32 GridAddressA;
+	int32 GridAddressB;
+	/** Points the move scores before any cascade. */
+	int32 Score;
+	/** Number of moves looked at. */
+	int32 NumMovesEvaluated;
+	/** False if the time budget ran out before every move was looked at. */
+	bool bSearchComplete;
+
+	FMatch3Hint()
+		: GridAddressA(INDEX_NONE)
+		, GridAddressB(INDEX_NONE)
+		, Score(0)
+		, NumMovesEvaluated(0)
+		, bSearchComplete(false)
+	{
+	}
+
+	bool IsValid() const { return (GridAddressA != INDEX_NONE); }
+};
+
+namespace Match3Hints
+{
+	/**
+	 * Find the available move that scores the most points, using the same score multipliers as the game. Ties go to the move whose match is lowest on the board,
+	 * since it moves more tiles and so is more likely to cascade. Only reads the request, so it is safe to call from a worker thread.
+	 */
+	MATCH3_API void FindBestMove(const FMatch3HintRequest& Request, FMatch3Hint& OutHint);
+}
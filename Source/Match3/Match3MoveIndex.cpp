@@ -0,0 +1,133 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "Match3.h"
+#include "Match3MoveIndex.h"
+
+FMatch3MoveIndex::FMatch3MoveIndex()
+	: Width(0)
+	, Height(0)
+	, NumBombs(0)
+{
+}
+
+void FMatch3MoveIndex::Rebuild(FMatch3Board& Board)
+{
+	Width = Board.GetWidth();
+	Height = Board.GetHeight();
+	const int32 NumSpaces = Board.GetNumSpaces();
+
+	LegalSwaps.Reset();
+	LegalSwapSlots.Init(INDEX_NONE, NumSpaces * NumDirections);
+	Bombs.Init(false, NumSpaces);
+	NumBombs = 0;
+
+	for (int32 GridAddress = 0; GridAddress < NumSpaces; ++GridAddress)
+	{
+		EvaluateSpace(Board, GridAddress);
+	}
+	Board.ClearDirtyRegion();
+}
+
+void FMatch3MoveIndex::Update(FMatch3Board& Board)
+{
+	if ((Width != Board.GetWidth()) || (Height != Board.GetHeight()))
+	{
+		Rebuild(Board);
+		return;
+	}
+	if (!Board.IsDirty())
+	{
+		return;
+	}
+
+	// A swap's legality depends on tiles up to MinimumRunLength - 1 spaces past either end of it along both axes.
+	// Grow each dirty column range by a full run length in every direction to cover both ends of every affected swap.
+	const int32 Margin = FMath::Max(1, Board.GetMinimumRunLength());
+	EvaluateMinY.Init(Height, Width);
+	EvaluateMaxY.Init(-1, Width);
+	for (int32 X = 0; X < Width; ++X)
+	{
+		int32 DirtyMinY, DirtyMaxY;
+		if (Board.GetDirtyRows(X, DirtyMinY, DirtyMaxY))
+		{
+			const int32 MinY = FMath::Max(0, DirtyMinY - Margin);
+			const int32 MaxY = FMath::Min(Height - 1, DirtyMaxY + Margin);
+			for (int32 EvaluateX = FMath::Max(0, X - Margin); EvaluateX <= FMath::Min(Width - 1, X + Margin); ++EvaluateX)
+			{
+				EvaluateMinY[EvaluateX] = FMath::Min(EvaluateMinY[EvaluateX], MinY);
+				EvaluateMaxY[EvaluateX] = FMath::Max(EvaluateMaxY[EvaluateX], MaxY);
+			}
+		}
+	}
+
+	for (int32 X = 0; X < Width; ++X)
+	{
+		for (int32 Y = EvaluateMinY[X]; Y <= EvaluateMaxY[X]; ++Y)
+		{
+			EvaluateSpace(Board, X + (Y * Width));
+		}
+	}
+	Board.ClearDirtyRegion();
+}
+
+void FMatch3MoveIndex::EvaluateSpace(const FMatch3Board& Board, int32 GridAddress)
+{
+	const bool bIsBomb = Board.CanExplode(GridAddress);
+	if (Bombs[GridAddress] != bIsBomb)
+	{
+		Bombs[GridAddress] = bIsBomb;
+		NumBombs += bIsBomb ? 1 : -1;
+	}
+
+	// IsMoveLegal is symmetric, so only the swaps to the right and upward are stored.
+	int32 NeighborGridAddress;
+	SetSwapLegal((GridAddress * NumDirections) + Right, Board.GetGridAddressWithOffset(GridAddress, 1, 0, NeighborGridAddress) && Board.IsMoveLegal(GridAddress, NeighborGridAddress));
+	SetSwapLegal((GridAddress * NumDirections) + Up, Board.GetGridAddressWithOffset(GridAddress, 0, 1, NeighborGridAddress) && Board.IsMoveLegal(GridAddress, NeighborGridAddress));
+}
+
+void FMatch3MoveIndex::SetSwapLegal(int32 SwapID, bool bLegal)
+{
+	int32& Slot = LegalSwapSlots[SwapID];
+	if (bLegal && (Slot == INDEX_NONE))
+	{
+		Slot = LegalSwaps.Add(SwapID);
+	}
+	else if (!bLegal && (Slot != INDEX_NONE))
+	{
+		// Fill the hole with the last entry so removal stays constant-time.
+		const int32 MovedSwapID = LegalSwaps.Last();
+		LegalSwaps.RemoveAtSwap(Slot, 1, false);
+		if (MovedSwapID != SwapID)
+		{
+			LegalSwapSlots[MovedSwapID] = Slot;
+		}
+		Slot = INDEX_NONE;
+	}
+}
+
+void FMatch3MoveIndex::GetLegalSwap(int32 SwapIndex, int32& OutGridAddressA, int32& OutGridAddressB) const
+{
+	const int32 SwapID = LegalSwaps[SwapIndex];
+	OutGridAddressA = SwapID / NumDirections;
+	OutGridAddressB = OutGridAddressA + (((SwapID % NumDirections) == Right) ? 1 : Width);
+}
+
+bool FMatch3MoveIndex::IsSwapLegal(int32 GridAddressA, int32 GridAddressB) const
+{
+	const int32 LowAddress = FMath::Min(GridAddressA, GridAddressB);
+	const int32 Offset = FMath::Abs(GridAddressA - GridAddressB);
+	if (!LegalSwapSlots.IsValidIndex(LowAddress * NumDirections))
+	{
+		return false;
+	}
+	if (Offset == Width)
+	{
+		return (LegalSwapSlots[(LowAddress * NumDirections) + Up] != INDEX_NONE);
+	}
+	// Offsets of 1 that wrap onto the next row are never legal, and are never stored.
+	if (Offset == 1)
+	{
+		return (LegalSwapSlots[(LowAddress * NumDirections) + Right] != INDEX_NONE);
+	}
+	return false;
+}
@@ -0,0 +1,63 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Match3Board.h"
+
+/**
+ * Index of every move currently available on a board: legal swaps between neighbors, and bombs.
+ * After the first full build, only swaps near the board's dirty region are re-evaluated, so keeping it current after a cascade is cheap.
+ */
+class MATCH3_API FMatch3MoveIndex
+{
+public:
+	FMatch3MoveIndex();
+
+	/** Evaluate every possible move on the board, and clear the board's dirty region. */
+	void Rebuild(FMatch3Board& Board);
+
+	/** Re-evaluate only the moves that changes in the board's dirty region can affect, then clear the dirty region. Does nothing if the board is clean. */
+	void Update(FMatch3Board& Board);
+
+	/** True if the player can do anything on the board. */
+	bool HasLegalMove() const { return (LegalSwaps.Num() > 0) || (NumBombs > 0); }
+
+	int32 GetNumLegalSwaps() const { return LegalSwaps.Num(); }
+	int32 GetNumBombs() const { return NumBombs; }
+
+	/** Get the legal swap at the given index, from 0 to GetNumLegalSwaps() - 1. The order of swaps changes as the index is updated. */
+	void GetLegalSwap(int32 SwapIndex, int32& OutGridAddressA, int32& OutGridAddressB) const;
+
+	/** True if the space holds a tile that can be detonated. */
+	bool IsBomb(int32 GridAddress) const { return Bombs[GridAddress]; }
+
+	/** True if swapping the tiles at the two addresses is currently legal. */
+	bool IsSwapLegal(int32 GridAddressA, int32 GridAddressB) const;
+
+private:
+	/** Each space owns two swaps: with the space to its right and with the space above it. */
+	enum ESwapDirection
+	{
+		Right = 0,
+		Up = 1,
+		NumDirections = 2
+	};
+
+	void EvaluateSpace(const FMatch3Board& Board, int32 GridAddress);
+	void SetSwapLegal(int32 SwapID, bool bLegal);
+
+	int32 Width;
+	int32 Height;
+
+	/** Legal swaps, stored as (GridAddress * NumDirections) + ESwapDirection. Order is not meaningful. */
+	TArray<int32> LegalSwaps;
+	/** Position of each swap in LegalSwaps, or INDEX_NONE if the swap is not legal. */
+	TArray<int32> LegalSwapSlots;
+	/** Whether each space holds a bomb. */
+	TArray<bool> Bombs;
+	int32 NumBombs;
+
+	/** Scratch space used while updating, one range of rows to re-evaluate per column. */
+	TArray<int32> EvaluateMinY;
+	TArray<int32> EvaluateMaxY;
+};
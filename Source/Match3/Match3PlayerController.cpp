@@ -2,30 +2,190 @@
 
 #include "Match3.h"
 #include "Match3PlayerController.h"
+#include "Grid.h"
+#include "EngineUtils.h"
 
 AMatch3PlayerController::AMatch3PlayerController(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
 	// We want the mouse cursor to show immediately on startup, without having to click in the window.
 	bShowMouseCursor = true;
 
-	// We need click/touch events to interact with our tiles.
-	bEnableTouchEvents = bEnableClickEvents = true;
-	bEnableTouchOverEvents = bEnableMouseOverEvents = true;
+	// Tiles are picked with grid math instead of collision traces, so per-actor click, touch and over events aren't needed.
+	bEnableTouchEvents = bEnableClickEvents = false;
+	bEnableTouchOverEvents = bEnableMouseOverEvents = false;
 
-	ScoreChangeRate = 375.0f;
+	// The old 1 ms timer added 375 points per second on every call, which at 60 frames per second came to about 6250 points per second.
+	ScoreChangeRate = 6250.0f;
+	SwipeDistance = 0.6f;
+	PressGridAddress = INDEX_NONE;
+	PressFingerIndex = ETouchIndex::Touch1;
+	bMousePressActive = false;
+	bPressSwiped = false;
+	CachedScoreTextValue = INDEX_NONE;
+}
+
+void AMatch3PlayerController::SetupInputComponent()
+{
+	Super::SetupInputComponent();
+
+	InputComponent->BindTouch(IE_Pressed, this, &AMatch3PlayerController::OnTouchPressed);
+	InputComponent->BindTouch(IE_Repeat, this, &AMatch3PlayerController::OnTouchMoved);
+	InputComponent->BindTouch(IE_Released, this, &AMatch3PlayerController::OnTouchReleased);
+	InputComponent->BindKey(EKeys::LeftMouseButton, IE_Pressed, this, &AMatch3PlayerController::OnMousePressed);
+	InputComponent->BindKey(EKeys::LeftMouseButton, IE_Released, this, &AMatch3PlayerController::OnMouseReleased);
+}
+
+void AMatch3PlayerController::PlayerTick(float DeltaTime)
+{
+	Super::PlayerTick(DeltaTime);
+
+	// Mouse movement isn't an input event, so a held button is followed here.
+	FVector2D MousePosition;
+	if (bMousePressActive && GetMousePosition(MousePosition.X, MousePosition.Y))
+	{
+		UpdatePress(MousePosition);
+	}
+
+	if (DisplayedScore < (float)Score)
+	{
+		TickScoreDisplay(DeltaTime);
+	}
+}
+
+AGrid* AMatch3PlayerController::GetGrid()
+{
+	if (!CachedGrid.IsValid())
+	{
+		for (TActorIterator<AGrid> It(GetWorld()); It; ++It)
+		{
+			CachedGrid = *It;
+			break;
+		}
+	}
+	return CachedGrid.Get();
+}
+
+bool AMatch3PlayerController::GetGridLocationAtScreenPosition(const FVector2D& ScreenPosition, FVector& OutGridLocation)
+{
+	AGrid* Grid = GetGrid();
+	FVector WorldLocation, WorldDirection;
+	return (Grid
+		&& DeprojectScreenPositionToWorld(ScreenPosition.X, ScreenPosition.Y, WorldLocation, WorldDirection)
+		&& Grid->GetGridPlaneIntersection(WorldLocation, WorldDirection, OutGridLocation));
+}
+
+bool AMatch3PlayerController::GetGridAddressAtScreenPosition(const FVector2D& ScreenPosition, int32& OutGridAddress)
+{
+	FVector GridLocation;
+	OutGridAddress = INDEX_NONE;
+	return (GetGridLocationAtScreenPosition(ScreenPosition, GridLocation) && GetGrid()->GetGridAddressFromLocation(GridLocation, OutGridAddress));
+}
+
+void AMatch3PlayerController::OnTouchPressed(ETouchIndex::Type FingerIndex, FVector Location)
+{
+	if ((PressGridAddress == INDEX_NONE) && !bMousePressActive)
+	{
+		PressFingerIndex = FingerIndex;
+		BeginPress(FVector2D(Location));
+	}
+}
+
+void AMatch3PlayerController::OnTouchMoved(ETouchIndex::Type FingerIndex, FVector Location)
+{
+	if (!bMousePressActive && (FingerIndex == PressFingerIndex))
+	{
+		UpdatePress(FVector2D(Location));
+	}
+}
+
+void AMatch3PlayerController::OnTouchReleased(ETouchIndex::Type FingerIndex, FVector Location)
+{
+	if (!bMousePressActive && (FingerIndex == PressFingerIndex))
+	{
+		EndPress();
+	}
+}
+
+void AMatch3PlayerController::OnMousePressed()
+{
+	FVector2D MousePosition;
+	if ((PressGridAddress == INDEX_NONE) && GetMousePosition(MousePosition.X, MousePosition.Y))
+	{
+		BeginPress(MousePosition);
+		bMousePressActive = (PressGridAddress != INDEX_NONE);
+	}
+}
+
+void AMatch3PlayerController::OnMouseReleased()
+{
+	if (bMousePressActive)
+	{
+		EndPress();
+	}
+}
+
+void AMatch3PlayerController::BeginPress(const FVector2D& ScreenPosition)
+{
+	EndPress();
+	if (UGameplayStatics::IsGamePaused(this) || !GetGridAddressAtScreenPosition(ScreenPosition, PressGridAddress))
+	{
+		return;
+	}
+
+	// We clicked or touched the tile.
+	AGrid* Grid = GetGrid();
+	Grid->OnTileWasSelected(Grid->GetTileFromGridAddress(PressGridAddress));
+}
+
+void AMatch3PlayerController::UpdatePress(const FVector2D& ScreenPosition)
+{
+	AGrid* Grid = GetGrid();
+	FVector GridLocation;
+	if ((PressGridAddress == INDEX_NONE) || bPressSwiped || !Grid || UGameplayStatics::IsGamePaused(this)
+		|| !GetGridLocationAtScreenPosition(ScreenPosition, GridLocation))
+	{
+		return;
+	}
+	// A swipe only moves the tile this press selected. If the press deselected it instead, dragging does nothing.
+	ATile* PressedTile = Grid->GetTileFromGridAddress(PressGridAddress);
+	if (!PressedTile || (Grid->GetCurrentlySelectedTile() != PressedTile))
+	{
+		return;
+	}
+
+	// Measure the drag in tiles from the center of the pressed tile, and follow whichever axis it has moved furthest along.
+	const FVector Drag = GridLocation - Grid->GetLocationFromGridAddress(PressGridAddress);
+	const float DragX = Drag.X / Grid->TileSize.X;
+	const float DragY = Drag.Z / Grid->TileSize.Y;
+	if (FMath::Max(FMath::Abs(DragX), FMath::Abs(DragY)) < SwipeDistance)
+	{
+		return;
+	}
+	bPressSwiped = true;
+	int32 SwipeGridAddress;
+	const bool bHorizontal = (FMath::Abs(DragX) >= FMath::Abs(DragY));
+	if (Grid->GetGridAddressWithOffset(PressGridAddress, bHorizontal ? (int32)FMath::Sign(DragX) : 0, bHorizontal ? 0 : (int32)FMath::Sign(DragY), SwipeGridAddress))
+	{
+		// Swiping onto a neighbor is the same as selecting it.
+		Grid->OnTileWasSelected(Grid->GetTileFromGridAddress(SwipeGridAddress));
+	}
+}
+
+void AMatch3PlayerController::EndPress()
+{
+	PressGridAddress = INDEX_NONE;
+	bMousePressActive = false;
+	bPressSwiped = false;
 }
 
 void AMatch3PlayerController::AddScore(int32 Points, bool bForceImmediateUpdate)
 {
 	Score += Points;
-	if (bForceImmediateUpdate)
+	// PlayerTick counts the displayed score up from here, so nothing needs to be scheduled.
+	if (bForceImmediateUpdate || (DisplayedScore > (float)Score))
 	{
 		DisplayedScore = (float)Score;
 	}
-	else
-	{
-		GetWorldTimerManager().SetTimer(TickScoreDisplayHandle, this, &AMatch3PlayerController::TickScoreDisplay, 0.001f, true);
-	}
 }
 
 int32 AMatch3PlayerController::GetScore()
@@ -38,18 +198,24 @@ int32 AMatch3PlayerController::GetDisplayedScore()
 	return (int32)DisplayedScore;
 }
 
+FText AMatch3PlayerController::GetDisplayedScoreAsText()
+{
+	const int32 Value = GetDisplayedScore();
+	if (Value != CachedScoreTextValue)
+	{
+		CachedScoreTextValue = Value;
+		CachedScoreText = FText::AsNumber(Value);
+	}
+	return CachedScoreText;
+}
+
 int32 AMatch3PlayerController::CalculateBombPower_Implementation()
 {
 	return 0;
 }
 
-void AMatch3PlayerController::TickScoreDisplay()
+void AMatch3PlayerController::TickScoreDisplay(float DeltaTime)
 {
 	// This assumes score only goes up, or instantly drops when it is decreased.
-	DisplayedScore += UGameplayStatics::GetWorldDeltaSeconds(this) * ScoreChangeRate;
-	if (DisplayedScore >= (float)Score)
-	{
-		DisplayedScore = Score;
-		GetWorldTimerManager().ClearTimer(TickScoreDisplayHandle);
-	}
+	DisplayedScore = FMath::Min(DisplayedScore + (DeltaTime * ScoreChangeRate), (float)Score);
 }
\ No newline at end of file
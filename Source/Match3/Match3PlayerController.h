@@ -16,6 +16,12 @@ public:
 
 	AMatch3PlayerController(const FObjectInitializer& ObjectInitializer);
 
+	virtual void SetupInputComponent() override;
+	virtual void PlayerTick(float DeltaTime) override;
+
+	/** Get the grid space under a screen position, by meeting the view ray with the grid's plane. Returns false if the position isn't over the board. */
+	bool GetGridAddressAtScreenPosition(const FVector2D& ScreenPosition, int32& OutGridAddress);
+
 	/** Add points. If points are negative or we force immediate update, the score will display instantly instead of counting up. */
 	UFUNCTION(BlueprintCallable, Category = "Game")
 	void AddScore(int32 Points, bool bForceImmediateUpdate = false);
@@ -28,6 +34,10 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Game")
 	int32 GetDisplayedScore();
 
+	/** Get the score that is currently displayed as text, for binding to a text widget. The text is only rebuilt when the displayed score changes. */
+	UFUNCTION(BlueprintPure, Category = "Game")
+	FText GetDisplayedScoreAsText();
+
 	/** Override in BPs to power up bombs. */
 	UFUNCTION(BlueprintNativeEvent, Category = "Game")
 	int32 CalculateBombPower();
@@ -50,11 +60,50 @@ protected:
 	UPROPERTY()
 	float DisplayedScore;
 
-	/** Rate at which displayed score climbs to reach actual score. Currently does not go faster with bigger scores. */
+	/**
+	 * Rate at which displayed score climbs to reach actual score, in points per second. Currently does not go faster with bigger scores.
+	 * Values set before this was measured per second ran about 16.7 times faster at 60 frames per second, so multiply old overrides by that to keep their feel.
+	 */
 	UPROPERTY(EditAnywhere)
 	float ScoreChangeRate;
 
-	/** Periodic function to manage score updates */
-	void TickScoreDisplay();
-	FTimerHandle TickScoreDisplayHandle;
+	/** Distance, in tiles from the center of the pressed tile, that a press has to move before it counts as a swipe toward the neighboring tile. */
+	UPROPERTY(EditAnywhere, Category = "Input", meta = (ClampMin = "0.1"))
+	float SwipeDistance;
+
+	/** Touch and mouse input. Only one press is followed at a time. */
+	void OnTouchPressed(ETouchIndex::Type FingerIndex, FVector Location);
+	void OnTouchMoved(ETouchIndex::Type FingerIndex, FVector Location);
+	void OnTouchReleased(ETouchIndex::Type FingerIndex, FVector Location);
+	void OnMousePressed();
+	void OnMouseReleased();
+
+	/** Select the tile under a new press and start watching it for a swipe. */
+	void BeginPress(const FVector2D& ScreenPosition);
+	/** Select the neighboring tile if the press has moved far enough toward it. Each press makes at most one swipe. */
+	void UpdatePress(const FVector2D& ScreenPosition);
+	void EndPress();
+
+	/** Get the point on the grid's plane under a screen position. Returns false if there is no grid or the view ray doesn't meet its plane. */
+	bool GetGridLocationAtScreenPosition(const FVector2D& ScreenPosition, FVector& OutGridLocation);
+
+	/** Find the grid in the world, caching it for later calls. */
+	class AGrid* GetGrid();
+	TWeakObjectPtr<class AGrid> CachedGrid;
+
+	/** Grid address the current press started on, or INDEX_NONE if there is no press or it started off the board. */
+	int32 PressGridAddress;
+	/** Finger following the current touch press. */
+	ETouchIndex::Type PressFingerIndex;
+	/** True while the left mouse button is held after being pressed over the board. */
+	uint32 bMousePressActive : 1;
+	/** True if the current press has already swiped. */
+	uint32 bPressSwiped : 1;
+
+	/** Count the displayed score up toward the actual score. Called from PlayerTick while they differ. */
+	void TickScoreDisplay(float DeltaTime);
+
+	/** Displayed score, as a whole number, that the cached score text was built for. */
+	int32 CachedScoreTextValue;
+	FText CachedScoreText;
 };
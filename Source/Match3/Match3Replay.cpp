@@ -0,0 +1,276 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "Match3.h"
+#include "Match3Replay.h"
+#include "Grid.h"
+#include "Match3BoardSnapshot.h"
+#include "EngineUtils.h"
+
+/** True if a loading archive has at least NumBytes left. Checked before allocating for a count read from the file, so a damaged file can't ask for more memory than its own size. */
+static bool HasBytesLeft(FArchive& Ar, int64 NumBytes)
+{
+	return (NumBytes <= (Ar.TotalSize() - Ar.Tell()));
+}
+
+FMatch3Replay::FMatch3Replay()
+{
+	Reset();
+}
+
+void FMatch3Replay::Reset()
+{
+	Settings = FMatch3GameSettings();
+	Seed = 0;
+	Inputs.Reset();
+	StartingTileTypes.Reset();
+	StartingScore = 0;
+	StartingComboPower = 0;
+	bHasExpectedResult = false;
+	ExpectedScore = 0;
+	ExpectedBoardChecksum = 0;
+}
+
+void FMatch3Replay::Serialize(FArchive& Ar)
+{
+	uint32 Magic = FileMagic;
+	uint32 Version = FileVersion;
+	Ar << Magic;
+	Ar << Version;
+	if ((Magic != FileMagic) || (Version != FileVersion))
+	{
+		Ar.SetError();
+		return;
+	}
+
+	// Most values are small and non-negative, so they are packed into as few bytes as they need.
+	uint32 PackedValue = Settings.Width;
+	Ar.SerializeIntPacked(PackedValue);
+	Settings.Width = PackedValue;
+	PackedValue = Settings.Height;
+	Ar.SerializeIntPacked(PackedValue);
+	Settings.Height = PackedValue;
+	PackedValue = Settings.MinimumRunLength;
+	Ar.SerializeIntPacked(PackedValue);
+	Settings.MinimumRunLength = PackedValue;
+	if (Ar.IsLoading() && (Ar.IsError() || (Settings.Width <= 0) || (Settings.Height <= 0) || (Settings.Width > FMatch3BoardSnapshot::MaxSize) || (Settings.Height > FMatch3BoardSnapshot::MaxSize)
+		|| (Settings.MinimumRunLength <= 0) || (Settings.MinimumRunLength > FMatch3BoardSnapshot::MaxSize)))
+	{
+		Ar.SetError();
+		return;
+	}
+
+	// Each tile type takes 9 bytes: its probability, its bomb power and its flags.
+	PackedValue = Settings.TileTypes.Num();
+	Ar.SerializeIntPacked(PackedValue);
+	if (Ar.IsLoading())
+	{
+		if (Ar.IsError() || (PackedValue == 0) || (PackedValue >= FMatch3Board::EmptyTile) || !HasBytesLeft(Ar, (int64)PackedValue * 9))
+		{
+			Ar.SetError();
+			return;
+		}
+		Settings.TileTypes.SetNum(PackedValue);
+	}
+	for (FMatch3BoardTileType& TileType : Settings.TileTypes)
+	{
+		uint8 Flags = (TileType.bExplodes ? 1 : 0) | (TileType.bPreventSwapping ? 2 : 0);
+		Ar << TileType.Probability;
+		Ar << TileType.BombPower;
+		Ar << Flags;
+		TileType.bExplodes = ((Flags & 1) != 0);
+		TileType.bPreventSwapping = ((Flags & 2) != 0);
+	}
+	for (int32& ScoreMultiplier : Settings.ScoreMultipliers)
+	{
+		Ar << ScoreMultiplier;
+	}
+	Ar << Settings.InitialComboPower;
+	Ar << Settings.MaxComboPower;
+	uint8 bReshuffleOnDeadlock = Settings.bReshuffleOnDeadlock ? 1 : 0;
+	Ar << bReshuffleOnDeadlock;
+	Settings.bReshuffleOnDeadlock = (bReshuffleOnDeadlock != 0);
+	Ar << Seed;
+
+	// A game resumed from a board snapshot starts on the snapshot's board instead of one filled from the seed.
+	uint8 bHasStartingBoard = (StartingTileTypes.Num() > 0) ? 1 : 0;
+	Ar << bHasStartingBoard;
+	if (bHasStartingBoard)
+	{
+		if (Ar.IsLoading())
+		{
+			if (Ar.IsError() || !HasBytesLeft(Ar, (int64)Settings.Width * Settings.Height))
+			{
+				Ar.SetError();
+				return;
+			}
+			StartingTileTypes.SetNum(Settings.Width * Settings.Height);
+		}
+		Ar.Serialize(StartingTileTypes.GetData(), StartingTileTypes.Num());
+		Ar << StartingScore;
+		Ar << StartingComboPower;
+		for (uint8 TileTypeID : StartingTileTypes)
+		{
+			if (TileTypeID >= Settings.TileTypes.Num())
+			{
+				Ar.SetError();
+				return;
+			}
+		}
+	}
+	else
+	{
+		StartingTileTypes.Reset();
+	}
+
+	// Each input is its grid address, with the low bit set if a bomb power bonus follows.
+	// Every input takes at least one byte.
+	PackedValue = Inputs.Num();
+	Ar.SerializeIntPacked(PackedValue);
+	if (Ar.IsLoading())
+	{
+		if (Ar.IsError() || !HasBytesLeft(Ar, PackedValue))
+		{
+			Ar.SetError();
+			return;
+		}
+		Inputs.SetNum(PackedValue);
+	}
+	for (FMatch3ReplayInput& Input : Inputs)
+	{
+		PackedValue = ((uint32)Input.GridAddress << 1) | ((Input.BombPowerBonus != 0) ? 1 : 0);
+		Ar.SerializeIntPacked(PackedValue);
+		Input.GridAddress = (int32)(PackedValue >> 1);
+		if (PackedValue & 1)
+		{
+			Ar << Input.BombPowerBonus;
+		}
+		else
+		{
+			Input.BombPowerBonus = 0;
+		}
+	}
+
+	uint8 bHasResult = bHasExpectedResult ? 1 : 0;
+	Ar << bHasResult;
+	bHasExpectedResult = (bHasResult != 0);
+	if (bHasExpectedResult)
+	{
+		Ar << ExpectedScore;
+		Ar << ExpectedBoardChecksum;
+	}
+}
+
+bool FMatch3Replay::SaveToFile(const FString& Filename) const
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	const_cast<FMatch3Replay*>(this)->Serialize(Writer);
+	return FFileHelper::SaveArrayToFile(Bytes, *Filename);
+}
+
+bool FMatch3Replay::LoadFromFile(const FString& Filename)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Filename))
+	{
+		return false;
+	}
+	FMemoryReader Reader(Bytes);
+	Serialize(Reader);
+	return !Reader.IsError();
+}
+
+void FMatch3Replay::Play(FMatch3HeadlessGame& Game) const
+{
+	if (StartingTileTypes.Num() > 0)
+	{
+		Game.InitFromBoard(Settings, Seed, StartingTileTypes, StartingScore, StartingComboPower);
+	}
+	else
+	{
+		Game.Init(Settings, Seed);
+	}
+	for (const FMatch3ReplayInput& Input : Inputs)
+	{
+		Game.SelectTile(Input.GridAddress, Input.BombPowerBonus);
+	}
+}
+
+FString FMatch3Replay::GetReplayFilename(const FString& Name)
+{
+	FString Filename = FPaths::IsRelative(Name) ? FPaths::Combine(*FPaths::GameSavedDir(), TEXT("Replays"), *Name) : Name;
+	if (FPaths::GetExtension(Filename).IsEmpty())
+	{
+		Filename += TEXT(".m3replay");
+	}
+	return Filename;
+}
+
+static void SaveReplay(const TArray<FString>& Args, UWorld* World)
+{
+	const FString Name = (Args.Num() > 0) ? Args[0] : FDateTime::Now().ToString();
+	for (TActorIterator<AGrid> It(World); It; ++It)
+	{
+		const FString Filename = FMatch3Replay::GetReplayFilename(Name);
+		if (It->SaveReplay(Filename))
+		{
+			UE_LOG(LogMatch3, Log, TEXT("Saved replay of %s to %s."), *It->GetName(), *Filename);
+		}
+		else
+		{
+			UE_LOG(LogMatch3, Warning, TEXT("Failed to save replay of %s to %s."), *It->GetName(), *Filename);
+		}
+		return;
+	}
+	UE_LOG(LogMatch3, Warning, TEXT("No grid to save a replay from."));
+}
+
+static void PlayReplay(const TArray<FString>& Args)
+{
+	if (Args.Num() < 1)
+	{
+		UE_LOG(LogMatch3, Warning, TEXT("Usage: Match3.Replay.Play <Name> [Repeats]"));
+		return;
+	}
+	const FString Filename = FMatch3Replay::GetReplayFilename(Args[0]);
+	FMatch3Replay Replay;
+	if (!Replay.LoadFromFile(Filename))
+	{
+		UE_LOG(LogMatch3, Warning, TEXT("Couldn't load replay %s."), *Filename);
+		return;
+	}
+
+	const int32 Repeats = (Args.Num() > 1) ? FMath::Max(1, FCString::Atoi(*Args[1])) : 1;
+	FMatch3HeadlessGame Game;
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Repeat = 0; Repeat < Repeats; ++Repeat)
+	{
+		Replay.Play(Game);
+	}
+	const double SecondsPerGame = (FPlatformTime::Seconds() - StartTime) / Repeats;
+
+	const uint32 BoardChecksum = Game.GetBoard().GetChecksum();
+	UE_LOG(LogMatch3, Log, TEXT("Replay %s: %d inputs, %d matches, %d tiles spawned, score %d, board checksum %08x%s, %.3f ms per game."),
+		*Filename, Replay.Inputs.Num(), Game.GetNumMatches(), Game.GetNumTilesSpawned(), Game.GetScore(), BoardChecksum, Game.IsGameOver() ? TEXT(", no moves left") : TEXT(""), SecondsPerGame * 1000.0);
+	if (Replay.bHasExpectedResult)
+	{
+		if ((Game.GetScore() == Replay.ExpectedScore) && (BoardChecksum == Replay.ExpectedBoardChecksum))
+		{
+			UE_LOG(LogMatch3, Log, TEXT("Replay matches the recorded game."));
+		}
+		else
+		{
+			UE_LOG(LogMatch3, Error, TEXT("Replay does not match the recorded game, which ended with score %d and board checksum %08x."), Replay.ExpectedScore, Replay.ExpectedBoardChecksum);
+		}
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs SaveReplayCommand(
+	TEXT("Match3.Replay.Save"),
+	TEXT("Saves a replay of the current game. Arguments: [Name]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&SaveReplay));
+
+static FAutoConsoleCommand PlayReplayCommand(
+	TEXT("Match3.Replay.Play"),
+	TEXT("Plays a saved replay without a world as fast as possible, and checks that it ends the same way as the recorded game. Arguments: <Name> [Repeats]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&PlayReplay));
@@ -0,0 +1,63 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Match3HeadlessGame.h"
+
+/** One tile selection accepted by AGrid::OnTileWasSelected. */
+struct FMatch3ReplayInput
+{
+	int32 GridAddress;
+
+	/** The game mode's bomb power bonus at the time of the selection. Only recorded for selections that detonate a bomb. */
+	int32 BombPowerBonus;
+
+	FMatch3ReplayInput(int32 InGridAddress = INDEX_NONE, int32 InBombPowerBonus = 0)
+		: GridAddress(InGridAddress)
+		, BombPowerBonus(InBombPowerBonus)
+	{
+	}
+};
+
+/**
+ * Compact binary record of one game: its settings, random seed and every tile selection the grid accepted.
+ * Playing it on an FMatch3HeadlessGame reproduces the game's board and score without a world, at full speed.
+ */
+struct MATCH3_API FMatch3Replay
+{
+	/** File identifier and format version. Bump the version when the layout changes, or when the same seed and inputs would play out differently. */
+	static const uint32 FileMagic = 0x5052334D;
+	static const uint32 FileVersion = 5;
+
+	FMatch3GameSettings Settings;
+	int32 Seed;
+	TArray<FMatch3ReplayInput> Inputs;
+
+	/** Type ID in each space when the game was resumed from a board snapshot, in grid address order. Empty if the game started on a board filled from Seed. */
+	TArray<uint8> StartingTileTypes;
+	/** Score and combo power the resumed game started with. Only used if StartingTileTypes is set. */
+	int32 StartingScore;
+	int32 StartingComboPower;
+
+	/** Score and board checksum at the time the replay was saved, if the board was settled, so playback can be checked against the original game. */
+	bool bHasExpectedResult;
+	int32 ExpectedScore;
+	uint32 ExpectedBoardChecksum;
+
+	FMatch3Replay();
+
+	/** Forget everything recorded so far. */
+	void Reset();
+
+	/** Read or write the replay. Sets an error on the archive if a loaded file is not a replay, has an unknown version, or holds sizes or counts that can't be right. */
+	void Serialize(FArchive& Ar);
+
+	bool SaveToFile(const FString& Filename) const;
+	bool LoadFromFile(const FString& Filename);
+
+	/** Start Game with the replay's settings, seed and starting board, and play every input. */
+	void Play(FMatch3HeadlessGame& Game) const;
+
+	/** Turn a replay name into a full path. Relative names are placed in the Replays folder under the project's Saved folder. */
+	static FString GetReplayFilename(const FString& Name);
+};
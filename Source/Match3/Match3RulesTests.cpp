@@ -0,0 +1,219 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "Match3.h"
+#include "Misc/AutomationTest.h"
+#include "Match3Board.h"
+#include "Match3CascadeResolver.h"
+#include "Match3HeadlessGame.h"
+#include "Match3TileSampler.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Checks for the board rules, run on small hand-built boards and on boards filled from fixed seeds.
+ * They need no world or rendering, so they can run under -nullrhi: -ExecCmds="Automation RunTests Match3.Rules"
+ */
+namespace Match3RulesTests
+{
+	/**
+	 * Build a board from rows of letters, top row first. 'A' is tile type 0, 'B' type 1 and so on, and '*' is a bomb.
+	 * The board has NumTileTypes plain types, plus a bomb type after them if any row uses one.
+	 */
+	static void BuildBoard(FMatch3Board& Board, const TArray<const TCHAR*>& Rows, int32 NumTileTypes)
+	{
+		const int32 Height = Rows.Num();
+		const int32 Width = FCString::Strlen(Rows[0]);
+		TArray<FMatch3BoardTileType> TileTypes;
+		TileTypes.SetNum(NumTileTypes + 1);
+		TileTypes[NumTileTypes].bExplodes = true;
+		Board.Init(Width, Height, 3);
+		Board.SetTileTypes(TileTypes);
+		for (int32 Y = 0; Y < Height; ++Y)
+		{
+			const TCHAR* Row = Rows[Height - 1 - Y];
+			check(FCString::Strlen(Row) == Width);
+			for (int32 X = 0; X < Width; ++X)
+			{
+				Board.SetTile(X + (Y * Width), (Row[X] == TEXT('*')) ? NumTileTypes : (Row[X] - TEXT('A')));
+			}
+		}
+	}
+
+	static int32 Address(const FMatch3Board& Board, int32 X, int32 Y)
+	{
+		return X + (Y * Board.GetWidth());
+	}
+
+	/** Sorted copy, so results can be compared without depending on search order. */
+	static TArray<int32> Sorted(TArray<int32> GridAddresses)
+	{
+		GridAddresses.Sort();
+		return GridAddresses;
+	}
+
+	static void CheckFindNeighbors(FAutomationTestBase& Test)
+	{
+		FMatch3Board Board;
+		TArray<int32> Found;
+
+		BuildBoard(Board, { TEXT("ABCD"), TEXT("BCDA"), TEXT("AAAB") }, 4);
+		Board.FindNeighbors(Address(Board, 0, 0), Found);
+		Test.TestTrue(TEXT("a horizontal run of three is found from its end"), Sorted(Found) == TArray<int32>({ 0, 1, 2 }));
+		Board.FindNeighbors(Address(Board, 1, 0), Found);
+		Test.TestTrue(TEXT("a horizontal run of three is found from its middle"), Found.Num() == 3);
+		Board.FindNeighbors(Address(Board, 3, 0), Found);
+		Test.TestTrue(TEXT("a lone tile is not a run"), Found.Num() == 0);
+
+		BuildBoard(Board, { TEXT("ACDB"), TEXT("ADCB"), TEXT("AAAC") }, 4);
+		Board.FindNeighbors(Address(Board, 0, 0), Found);
+		Test.TestTrue(FString::Printf(TEXT("an L of two runs sharing a corner has 5 tiles, found %d"), Found.Num()), Found.Num() == 5);
+		Board.FindNeighbors(Address(Board, 3, 1), Found);
+		Test.TestTrue(TEXT("a vertical pair is not a run"), Found.Num() == 0);
+		Board.FindNeighbors(Address(Board, 3, 1), Found, true, 2);
+		Test.TestTrue(TEXT("a vertical pair is a run when the run length is 2"), Found.Num() == 2);
+	}
+
+	static void CheckIsMoveLegal(FAutomationTestBase& Test)
+	{
+		FMatch3Board Board;
+		TArray<int32> Match;
+
+		BuildBoard(Board, { TEXT("ABCD"), TEXT("BCDA"), TEXT("AABA") }, 4);
+		Test.TestTrue(TEXT("a swap that completes a run is legal"), Board.IsMoveLegal(Address(Board, 2, 0), Address(Board, 3, 0), &Match));
+		Test.TestTrue(TEXT("a legal swap reports the run as it will be after the swap"), Sorted(Match) == TArray<int32>({ 0, 1, 2 }));
+		Test.TestTrue(TEXT("a legal swap is legal in both directions"), Board.IsMoveLegal(Address(Board, 3, 0), Address(Board, 2, 0)));
+		Test.TestTrue(TEXT("a swap that completes no run is illegal"), !Board.IsMoveLegal(Address(Board, 2, 0), Address(Board, 2, 1)));
+		Test.TestTrue(TEXT("swapping two tiles of the same type is illegal"), !Board.IsMoveLegal(Address(Board, 0, 0), Address(Board, 1, 0)));
+		Test.TestTrue(TEXT("swapping tiles that aren't neighbors is illegal"), !Board.IsMoveLegal(Address(Board, 1, 0), Address(Board, 3, 0)));
+		Test.TestTrue(TEXT("the ends of neighboring rows aren't neighbors"), !Board.IsMoveLegal(Address(Board, 3, 0), Address(Board, 0, 1)));
+	}
+
+	static void CheckBombs(FAutomationTestBase& Test)
+	{
+		FMatch3Board Board;
+		TArray<int32> Exploding;
+
+		BuildBoard(Board, { TEXT("ABCDA"), TEXT("BCDAB"), TEXT("CD*BC"), TEXT("DABCD"), TEXT("ABCDA") }, 4);
+		const int32 Bomb = Address(Board, 2, 2);
+		Board.GetExplosionList(Bomb, 1, Exploding);
+		Test.TestTrue(TEXT("a power 1 bomb only destroys itself"), Exploding.Num() == 1);
+		Board.GetExplosionList(Bomb, 2, Exploding);
+		Test.TestTrue(TEXT("a power 2 bomb destroys a plus of 5 tiles"), Sorted(Exploding) == Sorted(TArray<int32>({ Bomb, Bomb - 1, Bomb + 1, Bomb - 5, Bomb + 5 })));
+		Board.GetExplosionList(Bomb, 3, Exploding);
+		Test.TestTrue(TEXT("a power 3 bomb destroys a plus of 9 tiles"), Exploding.Num() == 9);
+		Board.GetExplosionList(Bomb, 10, Exploding);
+		Test.TestTrue(TEXT("an explosion stops at the edges of the board"), Exploding.Num() == 9);
+		Test.TestTrue(TEXT("bombs can't be swapped"), !Board.IsMoveLegal(Bomb, Bomb + 1));
+		Test.TestTrue(TEXT("a board with a bomb always has a move"), !Board.IsUnwinnable());
+	}
+
+	static void CheckIsUnwinnable(FAutomationTestBase& Test)
+	{
+		FMatch3Board Board;
+
+		// Each type only ever sits next to other types, and no swap can line up three of a kind.
+		BuildBoard(Board, { TEXT("CDCDCD"), TEXT("ABABAB"), TEXT("CDCDCD"), TEXT("ABABAB"), TEXT("CDCDCD"), TEXT("ABABAB") }, 4);
+		Test.TestTrue(TEXT("a board of repeating 2x2 blocks has no moves"), Board.IsUnwinnable());
+		Board.SetTile(Address(Board, 1, 1), 0);
+		Test.TestTrue(TEXT("changing one tile to set up a run gives the board a move"), !Board.IsUnwinnable());
+	}
+
+	static void CheckCascade(FAutomationTestBase& Test)
+	{
+		FMatch3GameSettings Settings;
+		Settings.TileTypes.SetNum(5);
+		FMatch3TileSampler TileSampler;
+		TileSampler.Init(Settings.TileTypes);
+
+		uint32 Checksums[2];
+		int32 Scores[2];
+		for (int32 Run = 0; Run < 2; ++Run)
+		{
+			FMatch3Board Board;
+			Board.Init(Settings.Width, Settings.Height, Settings.MinimumRunLength);
+			Board.SetTileTypes(Settings.TileTypes);
+			FRandomStream RandomStream(0x4D33);
+			TileSampler.FillBoard(Board, RandomStream);
+
+			TArray<int32> AllGridAddresses, Found;
+			for (int32 GridAddress = 0; GridAddress < Board.GetNumSpaces(); ++GridAddress)
+			{
+				AllGridAddresses.Add(GridAddress);
+			}
+			Board.FindMatches(AllGridAddresses, Found);
+			Test.TestTrue(TEXT("a filled board starts with no runs"), Found.Num() == 0);
+
+			// Treat the middle of the bottom row as matched, so the whole column-drop and refill path runs.
+			FMatch3CascadeResolver Resolver;
+			FMatch3CascadeScript Script;
+			const TArray<int32> Matched = { 2, 3, 4 };
+			Resolver.Resolve(Board, TileSampler, RandomStream, Settings, Matched, EMatch3MoveType::MT_Standard, 0, Script);
+
+			int32 StepScore = 0;
+			int32 StepSpawns = 0;
+			bool bFallsGoDown = true;
+			for (const FMatch3CascadeStep& Step : Script.Steps)
+			{
+				StepScore += Step.Score;
+				StepSpawns += Step.Spawns.Num();
+				for (const FMatch3CascadeFall& Fall : Step.Falls)
+				{
+					bFallsGoDown &= ((Fall.FromGridAddress % Board.GetWidth()) == (Fall.ToGridAddress % Board.GetWidth())) && (Fall.ToGridAddress < Fall.FromGridAddress);
+				}
+			}
+			Test.TestTrue(TEXT("the script has one step per match, starting with the move's match"), (Script.Steps.Num() == Script.NumMatches) && (Script.Steps[0].MatchedGridAddresses == Matched));
+			Test.TestTrue(TEXT("step scores add up to the cascade's score"), (StepScore == Script.Score) && (Script.Steps[0].Score == 3 * Settings.ScoreMultipliers[EMatch3MoveType::MT_Standard]));
+			Test.TestTrue(TEXT("every removed tile is replaced by a spawn"), (StepSpawns == Script.NumTilesSpawned) && (Script.NumTilesSpawned >= Matched.Num()));
+			Test.TestTrue(TEXT("tiles only fall straight down"), bFallsGoDown);
+
+			bool bFull = true;
+			for (int32 GridAddress = 0; GridAddress < Board.GetNumSpaces(); ++GridAddress)
+			{
+				bFull &= !Board.IsEmpty(GridAddress);
+			}
+			Board.FindMatches(AllGridAddresses, Found);
+			Test.TestTrue(TEXT("a resolved cascade leaves a full board with no runs"), bFull && (Found.Num() == 0));
+
+			Checksums[Run] = Board.GetChecksum();
+			Scores[Run] = Script.Score;
+		}
+		Test.TestTrue(TEXT("the same seed resolves to the same board and score"), (Checksums[0] == Checksums[1]) && (Scores[0] == Scores[1]));
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMatch3RulesFindNeighborsTest, "Match3.Rules.FindNeighbors", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FMatch3RulesFindNeighborsTest::RunTest(const FString& Parameters)
+{
+	Match3RulesTests::CheckFindNeighbors(*this);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMatch3RulesIsMoveLegalTest, "Match3.Rules.IsMoveLegal", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FMatch3RulesIsMoveLegalTest::RunTest(const FString& Parameters)
+{
+	Match3RulesTests::CheckIsMoveLegal(*this);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMatch3RulesBombsTest, "Match3.Rules.Bombs", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FMatch3RulesBombsTest::RunTest(const FString& Parameters)
+{
+	Match3RulesTests::CheckBombs(*this);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMatch3RulesIsUnwinnableTest, "Match3.Rules.IsUnwinnable", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FMatch3RulesIsUnwinnableTest::RunTest(const FString& Parameters)
+{
+	Match3RulesTests::CheckIsUnwinnable(*this);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMatch3RulesCascadeTest, "Match3.Rules.Cascade", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+bool FMatch3RulesCascadeTest::RunTest(const FString& Parameters)
+{
+	Match3RulesTests::CheckCascade(*this);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -2,7 +2,229 @@
 
 #include "Match3.h"
 #include "Match3SaveGame.h"
+#include "Match3SaveWriter.h"
 #include "Kismet/GameplayStatics.h"
+#include "PlatformFeatures.h"
+#include "SaveGameSystem.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+/** Header values for a shard of level records. */
+static const uint32 Match3LevelRecordFileTypeTag = 0x4D334C52;
+static const int32 Match3LevelRecordFileVersion = 1;
+static const int32 Match3LevelRecordHeaderSize = 3 * sizeof(int32);
+
+/** Read or write one record. Every field is a fixed-size integer, so each record takes RecordSize bytes. */
+static void SerializeLevelRecord(FArchive& Ar, uint32& LevelID, FMatch3LevelSaveData& Data)
+{
+	Ar << LevelID;
+	Ar << Data.GoldScore;
+	Ar << Data.SilverScore;
+	Ar << Data.BronzeScore;
+	Ar << Data.TopScore;
+}
+
+uint32 FMatch3LevelRecordStore::GetLevelID(const FString& LevelName)
+{
+	return FCrc::StrCrc32(*LevelName.ToLower());
+}
+
+FString FMatch3LevelRecordStore::GetShardSlotName(const FString& SlotName, int32 ShardIndex)
+{
+	return FString::Printf(TEXT("%s_Levels%02d"), *SlotName, ShardIndex);
+}
+
+FMatch3LevelRecordStore::FMatch3LevelRecordStore()
+	: DirtyShards(0)
+{
+}
+
+bool FMatch3LevelRecordStore::Find(const FString& LevelName, FMatch3LevelSaveData& OutData) const
+{
+	if (const FMatch3LevelSaveData* FoundData = Records.Find(GetLevelID(LevelName)))
+	{
+		OutData = *FoundData;
+		return true;
+	}
+	return false;
+}
+
+void FMatch3LevelRecordStore::Set(const FString& LevelName, const FMatch3LevelSaveData& NewData)
+{
+	const uint32 LevelID = GetLevelID(LevelName);
+	FMatch3LevelSaveData* Data = Records.Find(LevelID);
+	if (Data && (Data->GoldScore == NewData.GoldScore) && (Data->SilverScore == NewData.SilverScore) && (Data->BronzeScore == NewData.BronzeScore) && (Data->TopScore == NewData.TopScore))
+	{
+		return;
+	}
+	Records.Add(LevelID, NewData);
+	DirtyShards |= (1 << GetShardIndex(LevelID));
+}
+
+void FMatch3LevelRecordStore::Reset()
+{
+	Records.Reset();
+	DirtyShards = 0;
+}
+
+void FMatch3LevelRecordStore::EncodeShard(int32 ShardIndex, TArray<uint8>& OutBytes) const
+{
+	// Sorted, so the same records always encode to the same bytes.
+	TArray<uint32> LevelIDs;
+	for (const TPair<uint32, FMatch3LevelSaveData>& Record : Records)
+	{
+		if (GetShardIndex(Record.Key) == ShardIndex)
+		{
+			LevelIDs.Add(Record.Key);
+		}
+	}
+	LevelIDs.Sort();
+
+	OutBytes.Reset(Match3LevelRecordHeaderSize + (LevelIDs.Num() * RecordSize));
+	FMemoryWriter Writer(OutBytes);
+	uint32 FileTypeTag = Match3LevelRecordFileTypeTag;
+	int32 FileVersion = Match3LevelRecordFileVersion;
+	int32 NumRecords = LevelIDs.Num();
+	Writer << FileTypeTag;
+	Writer << FileVersion;
+	Writer << NumRecords;
+	for (uint32 LevelID : LevelIDs)
+	{
+		FMatch3LevelSaveData Data = Records.FindChecked(LevelID);
+		SerializeLevelRecord(Writer, LevelID, Data);
+	}
+}
+
+bool FMatch3LevelRecordStore::DecodeShard(const TArray<uint8>& Bytes)
+{
+	if (Bytes.Num() < Match3LevelRecordHeaderSize)
+	{
+		return false;
+	}
+	FMemoryReader Reader(Bytes);
+	uint32 FileTypeTag = 0;
+	int32 FileVersion = 0;
+	int32 NumRecords = 0;
+	Reader << FileTypeTag;
+	Reader << FileVersion;
+	Reader << NumRecords;
+	if ((FileTypeTag != Match3LevelRecordFileTypeTag) || (FileVersion != Match3LevelRecordFileVersion) || (NumRecords < 0)
+		|| (Bytes.Num() != Match3LevelRecordHeaderSize + (NumRecords * RecordSize)))
+	{
+		return false;
+	}
+
+	Records.Reserve(Records.Num() + NumRecords);
+	for (int32 RecordIndex = 0; RecordIndex < NumRecords; ++RecordIndex)
+	{
+		uint32 LevelID = 0;
+		FMatch3LevelSaveData Data;
+		SerializeLevelRecord(Reader, LevelID, Data);
+		Records.Add(LevelID, Data);
+	}
+	return true;
+}
+
+void FMatch3LevelRecordStore::WriteDirtyShards(FMatch3SaveWriter& SaveWriter, const FString& SlotName, int32 UserIndex)
+{
+	for (int32 ShardIndex = 0; ShardIndex < NumShards; ++ShardIndex)
+	{
+		if (IsShardDirty(ShardIndex))
+		{
+			TArray<uint8> Bytes;
+			EncodeShard(ShardIndex, Bytes);
+			SaveWriter.SaveData(GetShardSlotName(SlotName, ShardIndex), UserIndex, MoveTemp(Bytes));
+		}
+	}
+	ClearDirty();
+}
+
+bool FMatch3LevelRecordStore::LoadShards(const FString& SlotName, int32 UserIndex)
+{
+	Reset();
+	ISaveGameSystem* SaveSystem = IPlatformFeaturesModule::Get().GetSaveGameSystem();
+	if (!SaveSystem)
+	{
+		return false;
+	}
+
+	bool bSuccess = true;
+	TArray<uint8> Bytes;
+	for (int32 ShardIndex = 0; ShardIndex < NumShards; ++ShardIndex)
+	{
+		const FString ShardSlotName = GetShardSlotName(SlotName, ShardIndex);
+		if (SaveSystem->DoesSaveGameExist(*ShardSlotName, UserIndex))
+		{
+			Bytes.Reset();
+			if (!SaveSystem->LoadGame(false, *ShardSlotName, UserIndex, Bytes) || !DecodeShard(Bytes))
+			{
+				UE_LOG(LogMatch3, Warning, TEXT("Couldn't read level records from save game slot %s."), *ShardSlotName);
+				bSuccess = false;
+			}
+		}
+	}
+	return bSuccess;
+}
+
+void FMatch3LevelRecordStore::DeleteShards(const FString& SlotName, int32 UserIndex)
+{
+	for (int32 ShardIndex = 0; ShardIndex < NumShards; ++ShardIndex)
+	{
+		const FString ShardSlotName = GetShardSlotName(SlotName, ShardIndex);
+		if (UGameplayStatics::DoesSaveGameExist(ShardSlotName, UserIndex))
+		{
+			UGameplayStatics::DeleteGameInSlot(ShardSlotName, UserIndex);
+		}
+	}
+}
+
+UMatch3SaveGame::UMatch3SaveGame()
+	: bPropertiesDirty(false)
+{
+}
+
+bool UMatch3SaveGame::FindLevelData(const FString& LevelName, FMatch3LevelSaveData& OutData) const
+{
+	return LevelRecords.Find(LevelName, OutData);
+}
+
+void UMatch3SaveGame::SetLevelData(const FString& LevelName, const FMatch3LevelSaveData& NewData)
+{
+	LevelRecords.Set(LevelName, NewData);
+}
+
+void UMatch3SaveGame::LoadLevelRecords(const FString& SlotName, int32 UserIndex)
+{
+	LevelRecords.LoadShards(SlotName, UserIndex);
+
+	// Older saves kept every level in this object. Their data becomes dirty records, and this object is saved again without it.
+	if (Match3SaveData.Num() > 0)
+	{
+		for (const TPair<FString, FMatch3LevelSaveData>& LegacyData : Match3SaveData)
+		{
+			LevelRecords.Set(LegacyData.Key, LegacyData.Value);
+		}
+		Match3SaveData.Empty();
+		bPropertiesDirty = true;
+	}
+}
+
+void UMatch3SaveGame::WriteChanges(FMatch3SaveWriter& SaveWriter, const FString& SlotName, int32 UserIndex)
+{
+	// Records are queued first, so a save that drops legacy level data is never written before the records that replace it.
+	LevelRecords.WriteDirtyShards(SaveWriter, SlotName, UserIndex);
+	if (bPropertiesDirty)
+	{
+		SaveWriter.Save(this, SlotName, UserIndex);
+		bPropertiesDirty = false;
+	}
+}
+
+void UMatch3SaveGame::MarkAllDirty()
+{
+	bPropertiesDirty = true;
+	LevelRecords.MarkAllDirty();
+}
 
 bool UMatch3SaveGame::LoadCustomInt(FString FieldName, int32& Value) const
 {
@@ -17,11 +239,15 @@ bool UMatch3SaveGame::LoadCustomInt(FString FieldName, int32& Value) const
 
 void UMatch3SaveGame::SaveCustomInt(FString FieldName, int32 Value)
 {
-	Match3CustomIntData.FindOrAdd(FieldName) = Value;
+	const int32* ValuePointer = Match3CustomIntData.Find(FieldName);
+	if ((ValuePointer == nullptr) || (*ValuePointer != Value))
+	{
+		Match3CustomIntData.Add(FieldName, Value);
+		bPropertiesDirty = true;
+	}
 }
 
 void UMatch3SaveGame::ClearCustomInt(FString FieldName)
 {
-	Match3CustomIntData.Remove(FieldName);
+	bPropertiesDirty |= (Match3CustomIntData.Remove(FieldName) > 0);
 }
-
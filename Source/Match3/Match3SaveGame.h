@@ -27,6 +27,59 @@ struct FMatch3LevelSaveData
 	int32 TopScore;
 };
 
+class FMatch3SaveWriter;
+
+/**
+ * Saved data for every level, stored as fixed-size binary records keyed by a hash of the level name.
+ * Records are split by ID across a fixed number of shards, each saved to its own slot, so saving after one level changes only rewrites that level's shard.
+ * Level names are not stored, so two names with the same ID would share a record.
+ */
+class MATCH3_API FMatch3LevelRecordStore
+{
+public:
+	/** Number of slots that records are split across. */
+	static const int32 NumShards = 16;
+	/** Bytes taken by each record: the level ID and the four scores. */
+	static const int32 RecordSize = 5 * sizeof(int32);
+
+	/** ID that a level's record is stored under. Level names are matched without regard to case, as they are in the legacy map. */
+	static uint32 GetLevelID(const FString& LevelName);
+	static int32 GetShardIndex(uint32 LevelID) { return (int32)(LevelID % NumShards); }
+	/** Save slot that holds one shard of the records for a save slot. */
+	static FString GetShardSlotName(const FString& SlotName, int32 ShardIndex);
+
+	FMatch3LevelRecordStore();
+
+	bool Find(const FString& LevelName, FMatch3LevelSaveData& OutData) const;
+	/** Create or update a level's record. Its shard is only marked dirty if the data changed. */
+	void Set(const FString& LevelName, const FMatch3LevelSaveData& NewData);
+	int32 Num() const { return Records.Num(); }
+	/** Remove every record. */
+	void Reset();
+
+	bool IsShardDirty(int32 ShardIndex) const { return ((DirtyShards >> ShardIndex) & 1) != 0; }
+	/** Mark every shard dirty, so the next save writes all of them. Used when saving to a new slot. */
+	void MarkAllDirty() { DirtyShards = (1 << NumShards) - 1; }
+	void ClearDirty() { DirtyShards = 0; }
+
+	/** Write one shard's records, sorted by ID, after a small header. */
+	void EncodeShard(int32 ShardIndex, TArray<uint8>& OutBytes) const;
+	/** Add the records from an encoded shard. Returns false and adds nothing if the data isn't a valid shard. */
+	bool DecodeShard(const TArray<uint8>& Bytes);
+
+	/** Queue every dirty shard to be written to its slot, and mark them clean. */
+	void WriteDirtyShards(FMatch3SaveWriter& SaveWriter, const FString& SlotName, int32 UserIndex);
+	/** Replace the records with those saved for a slot. Shards that were never saved are treated as empty. Returns false if any shard couldn't be read. */
+	bool LoadShards(const FString& SlotName, int32 UserIndex);
+	/** Delete every shard saved for a slot. */
+	static void DeleteShards(const FString& SlotName, int32 UserIndex);
+
+private:
+	TMap<uint32, FMatch3LevelSaveData> Records;
+	/** One bit per shard that has changed since it was last written. */
+	uint32 DirtyShards;
+};
+
 /**
  * 
  */
@@ -36,6 +89,8 @@ class MATCH3_API UMatch3SaveGame : public USaveGame
 	GENERATED_BODY()
 
 public:
+	UMatch3SaveGame();
+
 	/**
 	*	@see UGameplayStatics::CreateSaveGameObject
 	*	@see UGameplayStatics::SaveGameToSlot
@@ -44,7 +99,25 @@ public:
 	*	@see UGameplayStatics::DeleteGameInSlot
 	*/
 
-	/** Complete list of levels played in Match3 mode. */
+	/** Find the saved data for a level played in Match3 mode. */
+	bool FindLevelData(const FString& LevelName, FMatch3LevelSaveData& OutData) const;
+
+	/** Create or update the saved data for a level. */
+	void SetLevelData(const FString& LevelName, const FMatch3LevelSaveData& NewData);
+
+	/** Load the level records saved for a slot, and move in any level data from a save made before levels had their own records. */
+	void LoadLevelRecords(const FString& SlotName, int32 UserIndex);
+
+	/** Queue everything that changed since the last save to be written. Level records are written to their own slots, next to SlotName. */
+	void WriteChanges(FMatch3SaveWriter& SaveWriter, const FString& SlotName, int32 UserIndex);
+
+	/** Mark everything as changed, so the next save writes all of it. Used when saving to a new slot. */
+	void MarkAllDirty();
+
+	/** Every level played in Match3 mode. Not serialized with this object; see WriteChanges. */
+	FMatch3LevelRecordStore LevelRecords;
+
+	/** Level data from saves made before levels had their own records. Emptied when loaded, so it is always saved empty. */
 	UPROPERTY()
 	TMap<FString, FMatch3LevelSaveData> Match3SaveData;
 
@@ -65,4 +138,7 @@ public:
 protected:
 	UPROPERTY()
 	TMap<FString, int32> Match3CustomIntData;
+
+	/** True if this object's own properties have changed since it was last saved. Level records keep track of their own changes. */
+	bool bPropertiesDirty;
 };
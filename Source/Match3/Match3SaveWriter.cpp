@@ -0,0 +1,147 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "Match3.h"
+#include "Match3SaveWriter.h"
+#include "Async/Async.h"
+#include "GameFramework/SaveGame.h"
+#include "PlatformFeatures.h"
+#include "SaveGameSystem.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Saves Coalesced"), STAT_Match3SavesCoalesced, STATGROUP_Match3);
+
+/** Header values written by UGameplayStatics::SaveGameToSlot. */
+static const int32 Match3SaveGameFileTypeTag = 0x53415647;
+static const int32 Match3SaveGameFileVersion = 1;
+
+FMatch3SaveWriter::FMatch3SaveWriter()
+	: bWriting(false)
+{
+}
+
+FMatch3SaveWriter::~FMatch3SaveWriter()
+{
+	// Background writes hold a reference to the writer, so none can be running here.
+	check(!bWriting);
+}
+
+void FMatch3SaveWriter::SerializeSaveGame(USaveGame* SaveGameObject, TArray<uint8>& OutBytes)
+{
+	OutBytes.Reset();
+	FMemoryWriter MemoryWriter(OutBytes, true);
+
+	// Same header as UGameplayStatics::SaveGameToSlot: file type, file version, engine version and save game class.
+	int32 FileTypeTag = Match3SaveGameFileTypeTag;
+	int32 SaveGameFileVersion = Match3SaveGameFileVersion;
+	int32 PackageFileUE4Version = GPackageFileUE4Version;
+	FEngineVersion SavedEngineVersion = FEngineVersion::Current();
+	FString SaveGameClassName = SaveGameObject->GetClass()->GetName();
+	MemoryWriter << FileTypeTag;
+	MemoryWriter << SaveGameFileVersion;
+	MemoryWriter << PackageFileUE4Version;
+	MemoryWriter << SavedEngineVersion;
+	MemoryWriter << SaveGameClassName;
+
+	// Then the object's state, with object references and names stored as strings.
+	FObjectAndNameAsStringProxyArchive Ar(MemoryWriter, false);
+	SaveGameObject->Serialize(Ar);
+}
+
+void FMatch3SaveWriter::Save(USaveGame* SaveGameObject, const FString& SlotName, int32 UserIndex)
+{
+	check(IsInGameThread());
+	if (!SaveGameObject)
+	{
+		return;
+	}
+	TArray<uint8> Data;
+	SerializeSaveGame(SaveGameObject, Data);
+	SaveData(SlotName, UserIndex, MoveTemp(Data));
+}
+
+void FMatch3SaveWriter::SaveData(const FString& SlotName, int32 UserIndex, TArray<uint8>&& Data)
+{
+	check(IsInGameThread());
+	bool bStartWriting = false;
+	{
+		FScopeLock Lock(&CriticalSection);
+		FPendingSave* PendingSave = PendingSaves.FindByPredicate([&SlotName](const FPendingSave& Pending) { return (Pending.SlotName == SlotName); });
+		if (PendingSave)
+		{
+			// The older data for this slot was never written, and never needs to be.
+			INC_DWORD_STAT(STAT_Match3SavesCoalesced);
+		}
+		else
+		{
+			PendingSave = &PendingSaves[PendingSaves.AddDefaulted()];
+			PendingSave->SlotName = SlotName;
+		}
+		PendingSave->UserIndex = UserIndex;
+		PendingSave->Data = MoveTemp(Data);
+		bStartWriting = !bWriting;
+		bWriting = true;
+	}
+
+	// A write already in progress picks up the new data when it finishes, so only one pool thread is ever writing.
+	if (bStartWriting)
+	{
+		TSharedRef<FMatch3SaveWriter, ESPMode::ThreadSafe> Writer = AsShared();
+		WriteFuture = Async<void>(EAsyncExecution::ThreadPool, [Writer]()
+		{
+			Writer->WritePendingSaves();
+		});
+	}
+}
+
+void FMatch3SaveWriter::WritePendingSaves()
+{
+	ISaveGameSystem* SaveSystem = IPlatformFeaturesModule::Get().GetSaveGameSystem();
+	for (;;)
+	{
+		FPendingSave PendingSave;
+		{
+			FScopeLock Lock(&CriticalSection);
+			if (PendingSaves.Num() == 0)
+			{
+				bWriting = false;
+				return;
+			}
+			PendingSave = MoveTemp(PendingSaves[0]);
+			PendingSaves.RemoveAt(0, 1, false);
+		}
+
+		const bool bSuccess = SaveSystem && (PendingSave.Data.Num() > 0) && SaveSystem->SaveGame(false, *PendingSave.SlotName, PendingSave.UserIndex, PendingSave.Data);
+		if (!bSuccess)
+		{
+			UE_LOG(LogMatch3, Warning, TEXT("Couldn't write save game slot %s."), *PendingSave.SlotName);
+		}
+		if (OnSaveCompleted)
+		{
+			FOnSaveCompleted Callback = OnSaveCompleted;
+			const FString SlotName = PendingSave.SlotName;
+			AsyncTask(ENamedThreads::GameThread, [Callback, SlotName, bSuccess]()
+			{
+				Callback(SlotName, bSuccess);
+			});
+		}
+	}
+}
+
+void FMatch3SaveWriter::Flush()
+{
+	check(IsInGameThread());
+	// Only the game thread queues saves, so once the running write has drained the queue there is nothing left to do.
+	if (WriteFuture.IsValid())
+	{
+		WriteFuture.Wait();
+		WriteFuture = TFuture<void>();
+	}
+	check(!IsBusy());
+}
+
+bool FMatch3SaveWriter::IsBusy() const
+{
+	FScopeLock Lock(&CriticalSection);
+	return bWriting;
+}
@@ -0,0 +1,67 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Async/Future.h"
+
+class USaveGame;
+
+/**
+ * Writes save games to their slots on a background thread, so saving never waits on storage.
+ * Save objects are serialized on the game thread when they are handed over, in the same format UGameplayStatics::SaveGameToSlot uses, so
+ * UGameplayStatics::LoadGameFromSlot reads them back as usual. If a slot is saved again before its last data was written, only the newest data is written.
+ * Must be created and used from the game thread.
+ */
+class MATCH3_API FMatch3SaveWriter : public TSharedFromThis<FMatch3SaveWriter, ESPMode::ThreadSafe>
+{
+public:
+	/**
+	 * Called on the game thread once data for a slot has been written, or has failed to write. Always queued as a game thread task, even for writes that Flush waited for,
+	 * so it runs after Flush returns, and not at all if the game thread stops processing tasks first.
+	 */
+	typedef TFunction<void(const FString& SlotName, bool bSuccess)> FOnSaveCompleted;
+
+	FMatch3SaveWriter();
+	~FMatch3SaveWriter();
+
+	void SetOnSaveCompleted(const FOnSaveCompleted& InOnSaveCompleted) { OnSaveCompleted = InOnSaveCompleted; }
+
+	/** Serialize a save game now and queue it to be written to a slot. */
+	void Save(USaveGame* SaveGameObject, const FString& SlotName, int32 UserIndex);
+
+	/** Queue data that is already serialized to be written to a slot. */
+	void SaveData(const FString& SlotName, int32 UserIndex, TArray<uint8>&& Data);
+
+	/** Block until every queued save has been written. Used when the application may be about to stop. Completion callbacks for these writes still arrive later; see FOnSaveCompleted. */
+	void Flush();
+
+	/** True if any save is queued or being written. */
+	bool IsBusy() const;
+
+	/** Serialize a save game with the header that UGameplayStatics::LoadGameFromSlot expects. */
+	static void SerializeSaveGame(USaveGame* SaveGameObject, TArray<uint8>& OutBytes);
+
+private:
+	/** Serialized data waiting to be written to one slot. */
+	struct FPendingSave
+	{
+		FString SlotName;
+		int32 UserIndex;
+		TArray<uint8> Data;
+	};
+
+	/** Write queued saves until there are none left. Runs on a pool thread. */
+	void WritePendingSaves();
+
+	/** Saves that haven't been written yet, oldest slot first. Each slot appears at most once. */
+	TArray<FPendingSave> PendingSaves;
+	/** True while a pool thread is running WritePendingSaves. */
+	bool bWriting;
+	/** Guards PendingSaves and bWriting. */
+	mutable FCriticalSection CriticalSection;
+
+	/** The most recent background write, kept so Flush can wait for it. Only used on the game thread. */
+	TFuture<void> WriteFuture;
+
+	FOnSaveCompleted OnSaveCompleted;
+};
@@ -0,0 +1,105 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "Match3.h"
+#include "Match3SessionContext.h"
+#include "Match3GameMode.h"
+#include "Match3PlayerController.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Session Lookups Saved"), STAT_Match3SessionLookupsSaved, STATGROUP_Match3);
+
+TMap<const UWorld*, FMatch3SessionContext> FMatch3SessionContext::Contexts;
+
+FMatch3SessionContext::FMatch3SessionContext()
+	: NumLookupsSaved(0)
+{
+}
+
+void FMatch3SessionContext::Register(AMatch3GameMode* GameMode)
+{
+	check(IsInGameThread());
+	if (GameMode && GameMode->GetWorld())
+	{
+		FMatch3SessionContext& Context = Contexts.FindOrAdd(GameMode->GetWorld());
+		Context = FMatch3SessionContext();
+		Context.GameMode = GameMode;
+	}
+}
+
+void FMatch3SessionContext::Unregister(AMatch3GameMode* GameMode)
+{
+	check(IsInGameThread());
+	if (GameMode)
+	{
+		Contexts.Remove(GameMode->GetWorld());
+	}
+}
+
+void FMatch3SessionContext::InvalidatePlayerController(const UObject* WorldContextObject)
+{
+	if (FMatch3SessionContext* Context = Find(WorldContextObject))
+	{
+		Context->PlayerController.Reset();
+	}
+}
+
+FMatch3SessionContext* FMatch3SessionContext::Find(const UObject* WorldContextObject)
+{
+	check(IsInGameThread());
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? Contexts.Find(World) : nullptr;
+}
+
+AMatch3GameMode* FMatch3SessionContext::GetGameMode(const UObject* WorldContextObject)
+{
+	if (FMatch3SessionContext* Context = Find(WorldContextObject))
+	{
+		if (AMatch3GameMode* GameMode = Context->GameMode.Get())
+		{
+			++Context->NumLookupsSaved;
+			INC_DWORD_STAT(STAT_Match3SessionLookupsSaved);
+			return GameMode;
+		}
+	}
+	return Cast<AMatch3GameMode>(UGameplayStatics::GetGameMode(WorldContextObject));
+}
+
+APlayerController* FMatch3SessionContext::GetLocalPlayerController(const UObject* WorldContextObject)
+{
+	FMatch3SessionContext* Context = Find(WorldContextObject);
+	if (Context)
+	{
+		if (APlayerController* PlayerController = Context->PlayerController.Get())
+		{
+			++Context->NumLookupsSaved;
+			INC_DWORD_STAT(STAT_Match3SessionLookupsSaved);
+			return PlayerController;
+		}
+	}
+
+	// Search the world's player controllers, and keep the result for next time.
+	APlayerController* PlayerController = UMatch3BlueprintFunctionLibrary::GetLocalPlayerController(WorldContextObject ? WorldContextObject->GetWorld() : nullptr);
+	if (Context)
+	{
+		Context->PlayerController = PlayerController;
+	}
+	return PlayerController;
+}
+
+AMatch3PlayerController* FMatch3SessionContext::GetPlayerController(const UObject* WorldContextObject)
+{
+	return Cast<AMatch3PlayerController>(GetLocalPlayerController(WorldContextObject));
+}
+
+int32 FMatch3SessionContext::GetNumLookupsSaved(const UObject* WorldContextObject)
+{
+	const FMatch3SessionContext* Context = Find(WorldContextObject);
+	return Context ? Context->NumLookupsSaved : 0;
+}
+
+void FMatch3SessionContext::ResetNumLookupsSaved(const UObject* WorldContextObject)
+{
+	if (FMatch3SessionContext* Context = Find(WorldContextObject))
+	{
+		Context->NumLookupsSaved = 0;
+	}
+}
@@ -0,0 +1,46 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+class AMatch3GameMode;
+class AMatch3PlayerController;
+
+/**
+ * Per-world cache of the game mode and local player controller, so that hot paths don't search for them on every call.
+ * The game mode creates its world's context in BeginPlay and removes it in EndPlay, and drops the cached player controller whenever a player joins or leaves.
+ * Worlds without a context, such as ones running a different game mode, fall back to the usual lookups.
+ */
+class MATCH3_API FMatch3SessionContext
+{
+public:
+	/** Create the context for the game mode's world. */
+	static void Register(AMatch3GameMode* GameMode);
+	/** Remove the context for the game mode's world. */
+	static void Unregister(AMatch3GameMode* GameMode);
+	/** Forget the cached player controller, so the next request looks for it again. */
+	static void InvalidatePlayerController(const UObject* WorldContextObject);
+
+	/** Get the world's Match3 game mode, or nullptr if it isn't running one. */
+	static AMatch3GameMode* GetGameMode(const UObject* WorldContextObject);
+	/** Get the world's first local player controller. */
+	static APlayerController* GetLocalPlayerController(const UObject* WorldContextObject);
+	/** Get the world's first local player controller, if it is a Match3 player controller. */
+	static AMatch3PlayerController* GetPlayerController(const UObject* WorldContextObject);
+
+	/** Number of searches that cached pointers have saved in the world since the last call to ResetNumLookupsSaved. */
+	static int32 GetNumLookupsSaved(const UObject* WorldContextObject);
+	static void ResetNumLookupsSaved(const UObject* WorldContextObject);
+
+	FMatch3SessionContext();
+
+private:
+	/** Find the context for the world that an object is in. */
+	static FMatch3SessionContext* Find(const UObject* WorldContextObject);
+
+	TWeakObjectPtr<AMatch3GameMode> GameMode;
+	TWeakObjectPtr<APlayerController> PlayerController;
+	int32 NumLookupsSaved;
+
+	/** One context per world with a Match3 game mode. Only used on the game thread. */
+	static TMap<const UWorld*, FMatch3SessionContext> Contexts;
+};
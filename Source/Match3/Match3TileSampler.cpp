@@ -0,0 +1,255 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "Match3.h"
+#include "Match3TileSampler.h"
+
+void FMatch3TileSampler::Init(const TArray<float>& InWeights)
+{
+	const int32 NumTypes = InWeights.Num();
+	Weights.SetNumUninitialized(NumTypes);
+	Probabilities.SetNumUninitialized(NumTypes);
+	Aliases.SetNumUninitialized(NumTypes);
+	if (NumTypes == 0)
+	{
+		return;
+	}
+
+	float TotalWeight = 0.0f;
+	for (int32 TypeIndex = 0; TypeIndex < NumTypes; ++TypeIndex)
+	{
+		Weights[TypeIndex] = FMath::Max(InWeights[TypeIndex], 0.0f);
+		TotalWeight += Weights[TypeIndex];
+	}
+	if (TotalWeight <= 0.0f)
+	{
+		// No type has a chance of appearing, so treat them all the same.
+		for (float& Weight : Weights)
+		{
+			Weight = 1.0f;
+		}
+		TotalWeight = NumTypes;
+	}
+
+	// Scale weights so that the average column holds exactly 1, then pair each underfull column with an overfull one.
+	TArray<float> ScaledWeights;
+	ScaledWeights.SetNumUninitialized(NumTypes);
+	TArray<int32> Small;
+	TArray<int32> Large;
+	Small.Reserve(NumTypes);
+	Large.Reserve(NumTypes);
+	for (int32 TypeIndex = 0; TypeIndex < NumTypes; ++TypeIndex)
+	{
+		ScaledWeights[TypeIndex] = Weights[TypeIndex] * NumTypes / TotalWeight;
+		Aliases[TypeIndex] = TypeIndex;
+		if (ScaledWeights[TypeIndex] < 1.0f)
+		{
+			Small.Add(TypeIndex);
+		}
+		else
+		{
+			Large.Add(TypeIndex);
+		}
+	}
+
+	while ((Small.Num() > 0) && (Large.Num() > 0))
+	{
+		const int32 SmallIndex = Small.Pop(false);
+		const int32 LargeIndex = Large.Last();
+		Probabilities[SmallIndex] = ScaledWeights[SmallIndex];
+		Aliases[SmallIndex] = LargeIndex;
+		ScaledWeights[LargeIndex] -= (1.0f - ScaledWeights[SmallIndex]);
+		if (ScaledWeights[LargeIndex] < 1.0f)
+		{
+			Large.Pop(false);
+			Small.Add(LargeIndex);
+		}
+	}
+
+	// Whatever is left is full, give or take rounding error.
+	for (int32 TypeIndex : Small)
+	{
+		Probabilities[TypeIndex] = 1.0f;
+	}
+	for (int32 TypeIndex : Large)
+	{
+		Probabilities[TypeIndex] = 1.0f;
+	}
+}
+
+void FMatch3TileSampler::Init(const TArray<FMatch3BoardTileType>& TileTypes)
+{
+	TArray<float> Weights;
+	Weights.Reserve(TileTypes.Num());
+	for (const FMatch3BoardTileType& TileType : TileTypes)
+	{
+		Weights.Add(TileType.Probability);
+	}
+	Init(Weights);
+}
+
+int32 FMatch3TileSampler::Sample(FRandomStream& RandomStream) const
+{
+	const int32 NumTypes = Probabilities.Num();
+	if (NumTypes == 0)
+	{
+		return 0;
+	}
+
+	// The whole part of the scaled draw picks a column and the fractional part decides between the column's type and its alias.
+	const float Draw = RandomStream.FRand() * NumTypes;
+	const int32 Column = FMath::Min(FMath::TruncToInt(Draw), NumTypes - 1);
+	return ((Draw - Column) < Probabilities[Column]) ? Column : Aliases[Column];
+}
+
+int32 FMatch3TileSampler::SampleStartingTile(const FMatch3Board& Board, int32 GridAddress, FRandomStream& RandomStream) const
+{
+	// Only the type of the tile to the left or the tile below can complete a run, so at most two types are ruled out.
+	int32 ExcludedTypes[2] = { INDEX_NONE, INDEX_NONE };
+	const int32 Width = Board.GetWidth();
+	const int32 NeighborAddresses[2] = { ((GridAddress % Width) > 0) ? (GridAddress - 1) : INDEX_NONE, (GridAddress >= Width) ? (GridAddress - Width) : INDEX_NONE };
+	for (int32 NeighborIndex = 0; NeighborIndex < 2; ++NeighborIndex)
+	{
+		const int32 NeighborType = (NeighborAddresses[NeighborIndex] != INDEX_NONE) ? Board.GetTileType(NeighborAddresses[NeighborIndex]) : INDEX_NONE;
+		if ((NeighborType != INDEX_NONE) && (NeighborType != ExcludedTypes[0]) && Board.WouldCompleteRun(GridAddress, NeighborType))
+		{
+			ExcludedTypes[NeighborIndex] = NeighborType;
+		}
+	}
+
+	const int32 TileTypeID = Sample(RandomStream);
+	if ((TileTypeID != ExcludedTypes[0]) && (TileTypeID != ExcludedTypes[1]))
+	{
+		return TileTypeID;
+	}
+
+	// Draw again from the remaining types only. Together with the first draw, this picks each allowed type in proportion to its weight.
+	float AllowedWeight = 0.0f;
+	for (int32 TypeIndex = 0; TypeIndex < Weights.Num(); ++TypeIndex)
+	{
+		if ((TypeIndex != ExcludedTypes[0]) && (TypeIndex != ExcludedTypes[1]))
+		{
+			AllowedWeight += Weights[TypeIndex];
+		}
+	}
+	if (AllowedWeight <= 0.0f)
+	{
+		return TileTypeID;
+	}
+	float Draw = RandomStream.FRand() * AllowedWeight;
+	int32 LastAllowedType = TileTypeID;
+	for (int32 TypeIndex = 0; TypeIndex < Weights.Num(); ++TypeIndex)
+	{
+		if ((TypeIndex != ExcludedTypes[0]) && (TypeIndex != ExcludedTypes[1]) && (Weights[TypeIndex] > 0.0f))
+		{
+			LastAllowedType = TypeIndex;
+			Draw -= Weights[TypeIndex];
+			if (Draw < 0.0f)
+			{
+				break;
+			}
+		}
+	}
+	return LastAllowedType;
+}
+
+void FMatch3TileSampler::FillBoard(FMatch3Board& Board, FRandomStream& RandomStream) const
+{
+	const int32 Width = Board.GetWidth();
+	const int32 Height = Board.GetHeight();
+	for (int32 X = 0; X < Width; ++X)
+	{
+		for (int32 Y = 0; Y < Height; ++Y)
+		{
+			const int32 GridAddress = X + (Y * Width);
+			Board.SetTile(GridAddress, SampleStartingTile(Board, GridAddress, RandomStream));
+		}
+	}
+}
+
+bool FMatch3TileSampler::AddLegalMove(FMatch3Board& Board, FRandomStream& RandomStream) const
+{
+	const int32 Width = Board.GetWidth();
+	const int32 Height = Board.GetHeight();
+	const int32 NumSpaces = Board.GetNumSpaces();
+	const int32 RunLength = FMath::Max(Board.GetMinimumRunLength(), 1);
+	const int32 NumTypes = FMath::Min(Weights.Num(), Board.GetTileTypes().Num());
+	if ((NumSpaces == 0) || (NumTypes == 0))
+	{
+		return false;
+	}
+
+	// A placement is a run of RunLength - 1 tiles of one type, with one more tile of that type next to the space that would finish the run.
+	// The extra tile is either beside that space, or just past it along the run.
+	struct FPattern
+	{
+		FIntPoint Axis;
+		FIntPoint MoverOffset;
+	};
+	const FPattern Patterns[] =
+	{
+		{ FIntPoint(1, 0), FIntPoint(0, 1) },
+		{ FIntPoint(1, 0), FIntPoint(1, 0) },
+		{ FIntPoint(0, 1), FIntPoint(1, 0) },
+		{ FIntPoint(0, 1), FIntPoint(0, 1) },
+	};
+
+	TArray<int32> ChangedAddresses;
+	TArray<int32> OldTypes;
+	TArray<int32> Matches;
+	const int32 FirstAddress = RandomStream.RandRange(0, NumSpaces - 1);
+	const int32 FirstType = RandomStream.RandRange(0, NumTypes - 1);
+	for (int32 AddressIndex = 0; AddressIndex < NumSpaces; ++AddressIndex)
+	{
+		const int32 OriginAddress = (FirstAddress + AddressIndex) % NumSpaces;
+		const FIntPoint Origin(OriginAddress % Width, OriginAddress / Width);
+		for (const FPattern& Pattern : Patterns)
+		{
+			const FIntPoint Target = Origin + (Pattern.Axis * (RunLength - 1));
+			const FIntPoint Mover = Target + Pattern.MoverOffset;
+			if ((Mover.X >= Width) || (Mover.Y >= Height) || (Target.X >= Width) || (Target.Y >= Height))
+			{
+				continue;
+			}
+			const int32 TargetAddress = Target.X + (Target.Y * Width);
+			const int32 MoverAddress = Mover.X + (Mover.Y * Width);
+			for (int32 TypeIndex = 0; TypeIndex < NumTypes; ++TypeIndex)
+			{
+				const int32 TileTypeID = (FirstType + TypeIndex) % NumTypes;
+				const FMatch3BoardTileType& TileType = Board.GetTileTypes()[TileTypeID];
+				if ((Weights[TileTypeID] <= 0.0f) || !TileType.CanSwap() || (Board.GetTileType(TargetAddress) == TileTypeID))
+				{
+					continue;
+				}
+
+				// Place the tiles, and keep them if the swap works and nothing matches yet.
+				ChangedAddresses.Reset();
+				OldTypes.Reset();
+				for (int32 RunIndex = 0; RunIndex < RunLength; ++RunIndex)
+				{
+					const FIntPoint Space = (RunIndex < (RunLength - 1)) ? (Origin + (Pattern.Axis * RunIndex)) : Mover;
+					const int32 SpaceAddress = Space.X + (Space.Y * Width);
+					ChangedAddresses.Add(SpaceAddress);
+					OldTypes.Add(Board.GetTileType(SpaceAddress));
+					Board.SetTile(SpaceAddress, TileTypeID);
+				}
+				Board.FindMatches(ChangedAddresses, Matches);
+				if ((Matches.Num() == 0) && Board.IsMoveLegal(MoverAddress, TargetAddress))
+				{
+					return true;
+				}
+				for (int32 ChangeIndex = ChangedAddresses.Num() - 1; ChangeIndex >= 0; --ChangeIndex)
+				{
+					if (OldTypes[ChangeIndex] == INDEX_NONE)
+					{
+						Board.ClearTile(ChangedAddresses[ChangeIndex]);
+					}
+					else
+					{
+						Board.SetTile(ChangedAddresses[ChangeIndex], OldTypes[ChangeIndex]);
+					}
+				}
+			}
+		}
+	}
+	return false;
+}
@@ -0,0 +1,47 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Match3Board.h"
+
+/**
+ * Picks tile types at random, weighted by their probability values, in constant time using Vose's alias method.
+ * The tables are built once from the tile library and only need rebuilding when the library changes.
+ */
+class MATCH3_API FMatch3TileSampler
+{
+public:
+	/** Build the tables from one weight per tile type. Negative weights count as zero. If no weight is positive, every type is equally likely. */
+	void Init(const TArray<float>& Weights);
+	/** Build the tables from the probability values of a board's tile types. */
+	void Init(const TArray<FMatch3BoardTileType>& TileTypes);
+
+	/** Number of tile types the tables were built for. */
+	int32 Num() const { return Probabilities.Num(); }
+
+	/** Pick a tile type ID. Takes exactly one value from the random stream, so results only depend on the stream's seed. Returns 0 if there are no tile types. */
+	int32 Sample(FRandomStream& RandomStream) const;
+
+	/**
+	 * Pick a type for a space on a board that is being filled column by column from the bottom-left, from only the types that don't complete a run with the tiles already placed.
+	 * Takes at most two values from the random stream. If every type that can appear would complete a run, the first pick is kept.
+	 */
+	int32 SampleStartingTile(const FMatch3Board& Board, int32 GridAddress, FRandomStream& RandomStream) const;
+
+	/** Fill every space on the board with SampleStartingTile, column by column from the bottom-left. */
+	void FillBoard(FMatch3Board& Board, FRandomStream& RandomStream) const;
+
+	/**
+	 * Change a few tiles on a full board so that at least one swap is legal, without completing any run.
+	 * Tries every placement at most once, starting from a random one, so it always finishes. Returns false if no placement works, which can happen with fewer than three usable tile types.
+	 */
+	bool AddLegalMove(FMatch3Board& Board, FRandomStream& RandomStream) const;
+
+private:
+	/** Weight of each type, with negative weights clamped to zero. */
+	TArray<float> Weights;
+	/** Chance of keeping each column's own type rather than taking its alias. */
+	TArray<float> Probabilities;
+	/** Type picked when a column's own type is not kept. */
+	TArray<int32> Aliases;
+};
@@ -0,0 +1,118 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "Match3.h"
+#include "Match3Tuner.h"
+#include "Match3BotPolicy.h"
+#include "Async/ParallelFor.h"
+
+/** Games per unit of parallel work. Each batch gets its own game, bot and random streams. */
+static const int32 GamesPerBatch = 16;
+
+int32 FMatch3SimulationStats::GetPercentileScore(float Percentile) const
+{
+	if (Scores.Num() == 0)
+	{
+		return 0;
+	}
+	const int32 Rank = FMath::CeilToInt(FMath::Clamp(Percentile, 0.0f, 100.0f) * 0.01f * Scores.Num());
+	return Scores[FMath::Clamp(Rank - 1, 0, Scores.Num() - 1)];
+}
+
+bool Match3Tuner::SimulateGames(const FMatch3GameSettings& Settings, const FMatch3TimeModel& TimeModel, const FString& PolicyName, int32 NumGames, int32 Seed, FMatch3SimulationStats& OutStats)
+{
+	if (!FMatch3BotPolicy::Create(PolicyName).IsValid())
+	{
+		UE_LOG(LogMatch3, Error, TEXT("Unknown bot policy %s."), *PolicyName);
+		return false;
+	}
+
+	NumGames = FMath::Max(NumGames, 1);
+	TArray<uint8> Deadlocked;
+	OutStats.Scores.SetNumUninitialized(NumGames);
+	Deadlocked.SetNumZeroed(NumGames);
+	const int32 NumBatches = FMath::DivideAndRoundUp(NumGames, GamesPerBatch);
+	ParallelFor(NumBatches, [&](int32 BatchIndex)
+	{
+		TSharedPtr<FMatch3BotPolicy> Policy = FMatch3BotPolicy::Create(PolicyName);
+		FMatch3HeadlessGame Game;
+		FRandomStream BotRandomStream(Seed ^ (BatchIndex * 7919));
+		FMatch3BotMove Move;
+		const int32 LastGame = FMath::Min((BatchIndex + 1) * GamesPerBatch, NumGames);
+		for (int32 GameIndex = BatchIndex * GamesPerBatch; GameIndex < LastGame; ++GameIndex)
+		{
+			Game.Init(Settings, Seed + GameIndex);
+			float SecondsLeft = TimeModel.GameSeconds;
+			while (!Game.IsGameOver() && (Game.GetNumMoves() < TimeModel.MaxMovesPerGame))
+			{
+				// The player uses up game time choosing a move, and the timer is paused while it resolves.
+				SecondsLeft -= TimeModel.SecondsPerMove;
+				if ((SecondsLeft < 0.0f) || !Policy->ChooseMove(Game, BotRandomStream, Move))
+				{
+					break;
+				}
+				const int32 OldScore = Game.GetScore();
+				FMatch3BotPolicy::PlayMove(Game, Move);
+				const int32 NewScore = Game.GetScore();
+				for (const FMatch3TimeReward& Reward : TimeModel.Rewards)
+				{
+					if (Reward.ScoreInterval > 0)
+					{
+						SecondsLeft += ((NewScore / Reward.ScoreInterval) - (OldScore / Reward.ScoreInterval)) * Reward.Seconds;
+					}
+				}
+			}
+			OutStats.Scores[GameIndex] = Game.GetScore();
+			Deadlocked[GameIndex] = Game.IsGameOver() ? 1 : 0;
+		}
+	});
+
+	OutStats.Scores.Sort();
+	OutStats.NumDeadlocks = 0;
+	for (uint8 bDeadlocked : Deadlocked)
+	{
+		OutStats.NumDeadlocks += bDeadlocked;
+	}
+	return true;
+}
+
+float Match3Tuner::GetTargetError(const FMatch3SimulationStats& Stats, const FMatch3TunerTargets& Targets)
+{
+	const float ScoreError = FMath::Abs((float)(Stats.GetPercentileScore(50.0f) - Targets.MedianScore)) / FMath::Max(Targets.MedianScore, 1);
+	const float DeadlockError = FMath::Max(0.0f, Stats.GetDeadlockRate() - Targets.MaxDeadlockRate);
+	return (DeadlockError > 0.0f) ? (1000.0f + DeadlockError) : ScoreError;
+}
+
+bool Match3Tuner::TuneProbabilities(FMatch3GameSettings& Settings, const FMatch3TimeModel& TimeModel, const FString& PolicyName, const FMatch3TunerTargets& Targets, int32 NumGames, int32 NumSteps, int32 Seed, FMatch3SimulationStats& OutStats)
+{
+	if (!SimulateGames(Settings, TimeModel, PolicyName, NumGames, Seed, OutStats))
+	{
+		return false;
+	}
+	float BestError = GetTargetError(OutStats, Targets);
+	UE_LOG(LogMatch3, Display, TEXT("Starting point: median %d, deadlock rate %.2f%%, error %.4f"), OutStats.GetPercentileScore(50.0f), OutStats.GetDeadlockRate() * 100.0f, BestError);
+
+	// Step sizes shrink as the search goes on. The search itself uses a separate stream so it doesn't disturb the game seeds.
+	FRandomStream SearchRandomStream(Seed);
+	FMatch3GameSettings Candidate = Settings;
+	FMatch3SimulationStats CandidateStats;
+	for (int32 Step = 0; (Step < NumSteps) && (BestError > 0.0f) && (Settings.TileTypes.Num() > 0); ++Step)
+	{
+		const float StepSize = FMath::Lerp(0.5f, 0.05f, (float)Step / FMath::Max(NumSteps - 1, 1));
+		const int32 TileTypeID = SearchRandomStream.RandRange(0, Settings.TileTypes.Num() - 1);
+		const float Scale = (SearchRandomStream.FRand() < 0.5f) ? (1.0f + StepSize) : (1.0f / (1.0f + StepSize));
+		Candidate = Settings;
+		Candidate.TileTypes[TileTypeID].Probability = FMath::Max(Candidate.TileTypes[TileTypeID].Probability * Scale, KINDA_SMALL_NUMBER);
+
+		SimulateGames(Candidate, TimeModel, PolicyName, NumGames, Seed, CandidateStats);
+		const float CandidateError = GetTargetError(CandidateStats, Targets);
+		if (CandidateError < BestError)
+		{
+			BestError = CandidateError;
+			Settings = Candidate;
+			Swap(OutStats, CandidateStats);
+			UE_LOG(LogMatch3, Display, TEXT("Step %d: tile type %d probability x%.3f, median %d, deadlock rate %.2f%%, error %.4f"),
+				Step, TileTypeID, Scale, OutStats.GetPercentileScore(50.0f), OutStats.GetDeadlockRate() * 100.0f, BestError);
+		}
+	}
+	return true;
+}
@@ -0,0 +1,99 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Match3HeadlessGame.h"
+
+/** Extra game time awarded each time the score passes a multiple of ScoreInterval. Mirrors FMatch3Reward. */
+struct FMatch3TimeReward
+{
+	int32 ScoreInterval;
+	float Seconds;
+};
+
+/** How game time passes in simulated games. The game timer is paused while tiles move, so only the player's thinking time counts. */
+struct FMatch3TimeModel
+{
+	/** Length of a game before any rewards, in seconds. */
+	float GameSeconds;
+
+	/** Game time the player spends choosing each move. */
+	float SecondsPerMove;
+
+	/** Time awarded for scoring, as in AMatch3GameMode::Rewards. */
+	TArray<FMatch3TimeReward> Rewards;
+
+	/** Safety limit on moves per game, in case rewards keep extending the game forever. */
+	int32 MaxMovesPerGame;
+
+	FMatch3TimeModel()
+		: GameSeconds(60.0f)
+		, SecondsPerMove(1.5f)
+		, MaxMovesPerGame(10000)
+	{
+	}
+};
+
+/** Outcome of a batch of simulated games. */
+struct MATCH3_API FMatch3SimulationStats
+{
+	/** Final score of every game, sorted from lowest to highest. */
+	TArray<int32> Scores;
+
+	/** Games that ended because the board had no moves left before time ran out. */
+	int32 NumDeadlocks;
+
+	FMatch3SimulationStats()
+		: NumDeadlocks(0)
+	{
+	}
+
+	int32 GetNumGames() const { return Scores.Num(); }
+	float GetDeadlockRate() const { return (Scores.Num() > 0) ? ((float)NumDeadlocks / Scores.Num()) : 0.0f; }
+	/** Score at the given percentile, from 0 to 100, using the nearest rank. */
+	int32 GetPercentileScore(float Percentile) const;
+};
+
+/** What the tuner is aiming for. */
+struct FMatch3TunerTargets
+{
+	/** Median final score to aim for, usually the level's silver score. */
+	int32 MedianScore;
+
+	/** Highest acceptable fraction of games that end with no moves left. */
+	float MaxDeadlockRate;
+
+	/** Percentiles of the tuned score distribution used to suggest medal scores. */
+	float BronzePercentile;
+	float SilverPercentile;
+	float GoldPercentile;
+
+	FMatch3TunerTargets()
+		: MedianScore(0)
+		, MaxDeadlockRate(0.01f)
+		, BronzePercentile(25.0f)
+		, SilverPercentile(50.0f)
+		, GoldPercentile(90.0f)
+	{
+	}
+};
+
+/** Searches for tile probabilities that meet a level's targets, by simulating many bot-played games on every core. */
+namespace Match3Tuner
+{
+	/**
+	 * Play NumGames timed games with the named bot policy, spread across worker threads. Each batch of games has its own random streams seeded from Seed,
+	 * so results don't depend on how work is scheduled. Returns false if the policy name is unknown.
+	 */
+	MATCH3_API bool SimulateGames(const FMatch3GameSettings& Settings, const FMatch3TimeModel& TimeModel, const FString& PolicyName, int32 NumGames, int32 Seed, FMatch3SimulationStats& OutStats);
+
+	/** How far a batch of games is from the targets. Zero is perfect. Missing the deadlock target always costs more than any score error. */
+	MATCH3_API float GetTargetError(const FMatch3SimulationStats& Stats, const FMatch3TunerTargets& Targets);
+
+	/**
+	 * Hill-climb over tile probabilities, starting from the ones in Settings. Each step scales one tile type's probability and keeps the change if the new
+	 * probabilities get closer to the targets. Every candidate is simulated with the same seed, so comparisons aren't swamped by noise.
+	 * On return, Settings holds the best probabilities found and OutStats holds their simulation results.
+	 */
+	MATCH3_API bool TuneProbabilities(FMatch3GameSettings& Settings, const FMatch3TimeModel& TimeModel, const FString& PolicyName, const FMatch3TunerTargets& Targets, int32 NumGames, int32 NumSteps, int32 Seed, FMatch3SimulationStats& OutStats);
+}
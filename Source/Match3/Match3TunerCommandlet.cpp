@@ -0,0 +1,94 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#include "Match3.h"
+#include "Match3TunerCommandlet.h"
+#include "Match3Benchmark.h"
+#include "Match3Tuner.h"
+#include "Match3GameMode.h"
+
+UMatch3TunerCommandlet::UMatch3TunerCommandlet(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	IsClient = false;
+	IsServer = false;
+	LogToConsole = true;
+	HelpDescription = TEXT("Tunes a level's tile probabilities and medal scores by simulating bot-played games.");
+	HelpUsage = TEXT("-run=Match3Tuner [-Map=/Game/Maps/Name] [-Games=2000] [-Steps=60] [-Policy=Greedy] [-Seed=1] [-Seconds=<game mode time>] [-SecondsPerMove=1.5] [-TargetMedian=<silver score>] [-MaxDeadlockRate=0.01] [-Bronze=25] [-Silver=50] [-Gold=90]");
+}
+
+int32 UMatch3TunerCommandlet::Main(const FString& Params)
+{
+	const FString MapName = Match3Benchmark::GetMapNameFromParams(Params);
+	FMatch3GameSettings Settings;
+	const AMatch3GameMode* GameModeCDO = nullptr;
+	if (!Match3Benchmark::LoadLevelSettings(MapName, Settings, &GameModeCDO))
+	{
+		return 1;
+	}
+
+	// Defaults come from the level's game mode, so a plain run tunes toward the medal scores designers already set.
+	FMatch3TimeModel TimeModel;
+	FMatch3TunerTargets Targets;
+	if (GameModeCDO)
+	{
+		TimeModel.GameSeconds = GameModeCDO->GetStartingTime();
+		for (const FMatch3Reward& Reward : GameModeCDO->Rewards)
+		{
+			FMatch3TimeReward TimeReward;
+			TimeReward.ScoreInterval = Reward.ScoreInterval;
+			TimeReward.Seconds = Reward.TimeAwarded;
+			TimeModel.Rewards.Add(TimeReward);
+		}
+		Targets.MedianScore = GameModeCDO->SaveGameData.SilverScore;
+	}
+	int32 NumGames = 2000;
+	int32 NumSteps = 60;
+	int32 Seed = 1;
+	FString PolicyName = TEXT("Greedy");
+	FParse::Value(*Params, TEXT("Games="), NumGames);
+	FParse::Value(*Params, TEXT("Steps="), NumSteps);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("Policy="), PolicyName);
+	FParse::Value(*Params, TEXT("Seconds="), TimeModel.GameSeconds);
+	FParse::Value(*Params, TEXT("SecondsPerMove="), TimeModel.SecondsPerMove);
+	FParse::Value(*Params, TEXT("TargetMedian="), Targets.MedianScore);
+	FParse::Value(*Params, TEXT("MaxDeadlockRate="), Targets.MaxDeadlockRate);
+	FParse::Value(*Params, TEXT("Bronze="), Targets.BronzePercentile);
+	FParse::Value(*Params, TEXT("Silver="), Targets.SilverPercentile);
+	FParse::Value(*Params, TEXT("Gold="), Targets.GoldPercentile);
+	TimeModel.SecondsPerMove = FMath::Max(TimeModel.SecondsPerMove, 0.01f);
+
+	UE_LOG(LogMatch3, Display, TEXT("Tuning %s: %d games per step, %d steps, %.1f s games at %.2f s per move, target median %d, max deadlock rate %.2f%%"),
+		*MapName, NumGames, NumSteps, TimeModel.GameSeconds, TimeModel.SecondsPerMove, Targets.MedianScore, Targets.MaxDeadlockRate * 100.0f);
+
+	const double StartTime = FPlatformTime::Seconds();
+	FMatch3SimulationStats Stats;
+	if (!Match3Tuner::TuneProbabilities(Settings, TimeModel, PolicyName, Targets, NumGames, NumSteps, Seed, Stats))
+	{
+		return 1;
+	}
+	UE_LOG(LogMatch3, Display, TEXT("Simulated %d games per step in %.1f s."), Stats.GetNumGames(), FPlatformTime::Seconds() - StartTime);
+
+	float TotalProbability = 0.0f;
+	for (const FMatch3BoardTileType& TileType : Settings.TileTypes)
+	{
+		TotalProbability += TileType.Probability;
+	}
+	UE_LOG(LogMatch3, Display, TEXT("Tuned tile probabilities:"));
+	for (int32 TileTypeID = 0; TileTypeID < Settings.TileTypes.Num(); ++TileTypeID)
+	{
+		const float Probability = Settings.TileTypes[TileTypeID].Probability;
+		UE_LOG(LogMatch3, Display, TEXT("  TileLibrary[%d].Probability = %.4f  (%.1f%% of tiles)"), TileTypeID, Probability, 100.0f * Probability / FMath::Max(TotalProbability, SMALL_NUMBER));
+	}
+
+	UE_LOG(LogMatch3, Display, TEXT("Suggested medal scores: Bronze %d, Silver %d, Gold %d"),
+		Stats.GetPercentileScore(Targets.BronzePercentile), Stats.GetPercentileScore(Targets.SilverPercentile), Stats.GetPercentileScore(Targets.GoldPercentile));
+
+	UE_LOG(LogMatch3, Display, TEXT("Score distribution (deadlock rate %.2f%%):"), Stats.GetDeadlockRate() * 100.0f);
+	const float Percentiles[] = { 0.0f, 5.0f, 10.0f, 25.0f, 50.0f, 75.0f, 90.0f, 95.0f, 100.0f };
+	for (float Percentile : Percentiles)
+	{
+		UE_LOG(LogMatch3, Display, TEXT("  p%-3.0f %d"), Percentile, Stats.GetPercentileScore(Percentile));
+	}
+	return 0;
+}
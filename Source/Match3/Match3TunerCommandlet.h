@@ -0,0 +1,22 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "Match3TunerCommandlet.generated.h"
+
+/**
+ * Simulates thousands of bot-played games of a level on every core, searches for tile probabilities that meet score and deadlock targets,
+ * and suggests medal scores from the resulting score distribution.
+ * Example: UE4Editor-Cmd UnrealMatch3.uproject -run=Match3Tuner -Map=/Game/Maps/Match3 -Games=2000 -Steps=60 -nullrhi
+ */
+UCLASS()
+class UMatch3TunerCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMatch3TunerCommandlet(const FObjectInitializer& ObjectInitializer);
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -38,8 +38,8 @@ struct FTileAbilities
 {
 	GENERATED_USTRUCT_BODY();
 
-	bool CanExplode() { return bExplodes; }
-	bool CanSwap() { return (!bPreventSwapping && !bExplodes); }
+	bool CanExplode() const { return bExplodes; }
+	bool CanSwap() const { return (!bPreventSwapping && !bExplodes); }
 
 protected:
 	/** Tile explodes when selected (change this!) */
@@ -70,22 +70,6 @@ public:
 	void BeginPlay() override;
 	void Tick(float DeltaTime) override;
 
-	/** When a tile is touched. */
-	UFUNCTION()
-	void TilePress(ETouchIndex::Type FingerIndex, AActor* TouchedActor);
-
-	/** When the user's finger moves over a tile. */
-	UFUNCTION()
-	void TileEnter(ETouchIndex::Type FingerIndex, AActor* TouchedActor);
-
-	/** Mouse surrogate for TilePress. */
-	UFUNCTION()
-	void TilePress_Mouse(AActor* ClickedActor, FKey ButtonClicked);
-
-	/** Mouse surrogate for TileEnter. */
-	UFUNCTION()
-	void TileEnter_Mouse(AActor* MousedOverActor);
-
 	UFUNCTION(BlueprintImplementableEvent, Category = "Special Game Events")
 	void PlaySelectionEffect(bool bTurnEffectOn);
 
@@ -108,14 +92,19 @@ public:
 	void OnSwapMove(ATile* OtherTile, bool bMoveWillSucceed);
 	virtual void OnSwapMove_Implementation(ATile* OtherTile, bool bMoveWillSucceed);
 
-	void StartFalling(bool bUseCurrentWorldLocation = false);
+	/** Move from the tile's current location to the space at its grid address. The grid address must already be set to the landing space. */
+	void StartFalling();
 
-	USoundWave* GetMatchSound();
+	/** Called when the grid stops using this tile. The tile is hidden and reset so it can be reused for any grid address. */
+	void OnReturnedToPool();
 
+	/** Called when the grid takes this tile from its pool, after it has been moved to its new location. */
+	void OnTakenFromPool();
 
-	UFUNCTION()
-	void TickFalling();
+	USoundWave* GetMatchSound();
 
+
+	/** Called by the grid once this tile has been moved to the end of its fall. */
 	void FinishFalling();
 
 	void SetGridAddress(int32 NewLocation);
@@ -124,26 +113,17 @@ public:
 	UPROPERTY(BlueprintReadOnly)
 	int32 TileTypeID;
 
-	UPROPERTY()
-	TEnumAsByte<ETileState::Type> TileState;
-
 	UPROPERTY(BlueprintReadOnly)
 	FTileAbilities Abilities;
 
-protected:
-	float TotalFallingTime;
-	float FallingStartTime;
-	FVector FallingStartLocation;
-	FVector FallingEndLocation;
-	FTimerHandle TickFallingHandle;
+	/** Index of this tile's instance in the grid's grouped sprite component, or INDEX_NONE if the tile draws itself. */
+	int32 SpriteInstanceIndex;
 
+protected:
 	/** Location on the grid as a 1D key/value. To find neighbors, ask the grid. */
 	UPROPERTY(BlueprintReadOnly, Category = Tile)
 	int32 GridAddress;
 
-	/** Location where we will land on the grid as a 1D key/value. Used while falling. */
-	int32 LandingGridAddress;
-
 	/** The grid that owns this tile. Currently, this is set by casting the object that spawned the tile. */
 	UPROPERTY(BlueprintReadOnly, Category = Tile)
 	class AGrid* Grid;